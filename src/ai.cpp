@@ -1,6 +1,8 @@
 #include "ai.h"
 
+#include <algorithm>
 #include <string.h>
+#include <unordered_map>
 
 #include "constants/order.h"
 #include "constants/tech.h"
@@ -22,6 +24,7 @@
 #include "unit.h"
 #include "unitlist.h"
 #include "unitsearch.h"
+#include "warn.h"
 #include "yms.h"
 
 #include "perfclock.h"
@@ -58,6 +61,21 @@ static void MedicRemove(Unit *medic)
 
 ListHead<GuardAi, 0x0> needed_guards[0x8];
 
+/// UpdateGuardNeeds does not have to go through needed_guards before elapsed_seconds reaches
+/// time, unless the player deletes guards which have died thrice and there are some.
+/// Anything that adds to needed_guards or changes their respawn time sets time to 0.
+struct GuardNeedsWakeup
+{
+    uint32_t time;
+    bool has_died_thrice;
+};
+static GuardNeedsWakeup guard_needs_wakeup[Limits::ActivePlayers];
+
+static void WakeGuardNeeds(int player)
+{
+    guard_needs_wakeup[player].time = 0;
+}
+
 bool IsInAttack(Unit *unit)
 {
     switch (((Ai::MilitaryAi *)unit->ai)->region->state)
@@ -174,11 +192,192 @@ bool UpdateAttackTarget(Unit *unit, bool accept_if_sieged, bool accept_critters,
     return true;
 }
 
+/// Wakes ai scripts on the frame their wait runs out, instead of ProgressScripts decrementing
+/// the wait of every script each frame. Script::wait keeps the value bw last set until
+/// WriteWaits() is called, as Script is a bw struct and has no room for the timer.
+/// Scripts that wake on the same frame are run in the order they are in the script list,
+/// which is reverse creation order as scripts are always added to the head.
+class ScriptTimers
+{
+    public:
+        ScriptTimers() : frame(0), next_sequence(0) {}
+
+        /// New scripts have wait of 0, so they run on the next ProgressScripts
+        void Add(Script *script);
+        void Remove(Script *script);
+        void Progress();
+        /// Sets each Script::wait to the actual remaining wait
+        void WriteWaits();
+        /// Needed when the script list has been created without the Script constructor
+        void Rebuild();
+
+    private:
+        static const int WheelSize = 256;
+        struct Timer
+        {
+            /// ProgressScripts call on which the script runs
+            uint64_t wake;
+            uint32_t sequence;
+            /// Script::wait is expected to stay at this until the script runs
+            uint32_t wait;
+        };
+        struct Entry
+        {
+            Script *script;
+            uint32_t sequence;
+        };
+
+        void Schedule(Script *script, Timer *timer);
+        /// Returns nullptr if the entry is for a deleted script
+        Timer *Find(const Entry &entry);
+        void CheckWaits();
+
+        std::unordered_map<Script *, Timer> timers;
+        vector<Entry> wheel[WheelSize];
+        /// Entries which do not wake during the current round of the wheel
+        vector<Entry> far;
+        vector<Entry> due;
+        /// Amount of ProgressScripts calls
+        uint64_t frame;
+        uint32_t next_sequence;
+};
+
+static ScriptTimers script_timers;
+
+void ScriptTimers::Add(Script *script)
+{
+    Timer &timer = timers[script];
+    timer.sequence = next_sequence++;
+    timer.wait = script->wait;
+    Schedule(script, &timer);
+}
+
+void ScriptTimers::Remove(Script *script)
+{
+    timers.erase(script);
+}
+
+void ScriptTimers::Schedule(Script *script, Timer *timer)
+{
+    // Same as wait getting decremented to 0 on each ProgressScripts, the script running on
+    // the one after that
+    timer->wake = frame + 1 + timer->wait;
+    Entry entry = { script, timer->sequence };
+    if (timer->wake - (frame - frame % WheelSize) < WheelSize)
+        wheel[timer->wake % WheelSize].emplace_back(entry);
+    else
+        far.emplace_back(entry);
+}
+
+ScriptTimers::Timer *ScriptTimers::Find(const Entry &entry)
+{
+    auto it = timers.find(entry.script);
+    if (it == timers.end() || it->second.sequence != entry.sequence)
+        return nullptr;
+    return &it->second;
+}
+
+void ScriptTimers::CheckWaits()
+{
+    for (Script *script : *bw::first_active_ai_script)
+    {
+        auto it = timers.find(script);
+        if (it == timers.end())
+            Warning("Ai script %p (player %d) is not scheduled", script, script->player);
+        else if (it->second.wait != script->wait)
+        {
+            Warning("Wait of ai script %p (player %d) was changed from %x to %x outside ProgressScripts",
+                    script, script->player, it->second.wait, script->wait);
+        }
+    }
+}
+
+void ScriptTimers::Progress()
+{
+    if (Debug)
+        CheckWaits();
+    frame += 1;
+    if (frame % WheelSize == 0)
+    {
+        auto it = std::remove_if(far.begin(), far.end(), [this](const Entry &entry) {
+            Timer *timer = Find(entry);
+            if (timer == nullptr)
+                return true;
+            if (timer->wake - frame >= WheelSize)
+                return false;
+            wheel[timer->wake % WheelSize].emplace_back(entry);
+            return true;
+        });
+        far.erase(it, far.end());
+    }
+    auto &bucket = wheel[frame % WheelSize];
+    due.clear();
+    for (const Entry &entry : bucket)
+    {
+        Timer *timer = Find(entry);
+        if (timer != nullptr && timer->wake == frame)
+            due.emplace_back(entry);
+    }
+    bucket.clear();
+    std::sort(due.begin(), due.end(), [](const Entry &a, const Entry &b) {
+        return a.sequence > b.sequence;
+    });
+    for (const Entry &entry : due)
+    {
+        // Earlier scripts may have deleted this one
+        if (Find(entry) == nullptr)
+            continue;
+        Script *script = entry.script;
+        Assert(bw::players[script->player].type == 1 || !script->town);
+        script->wait = 0xffffffff;
+        if (script->flags & 0x4)
+        {
+            delete script;
+            continue;
+        }
+        bw::ProgressAiScript(script);
+        // The script may have been deleted, or another script may have been
+        // created to the same address
+        Timer *timer = Find(entry);
+        if (timer != nullptr)
+        {
+            timer->wait = script->wait;
+            Schedule(script, timer);
+        }
+    }
+}
+
+void ScriptTimers::WriteWaits()
+{
+    for (auto &pair : timers)
+    {
+        pair.first->wait = pair.second.wake - frame - 1;
+        pair.second.wait = pair.first->wait;
+    }
+}
+
+void ScriptTimers::Rebuild()
+{
+    timers.clear();
+    for (auto &bucket : wheel)
+        bucket.clear();
+    far.clear();
+    frame = 0;
+    next_sequence = 0;
+    // Scripts closer to the list head have to be run first, so they get larger sequence
+    vector<Script *> scripts;
+    for (Script *script : *bw::first_active_ai_script)
+        scripts.emplace_back(script);
+    for (auto it = scripts.rbegin(); it != scripts.rend(); ++it)
+        Add(*it);
+}
+
 Script::Script(uint32_t player_, uint32_t pos_, bool bwscript, const Rect32 *area_) : pos(pos_), player(player_)
 {
     flags = bwscript ? 0x1 : 0x0;
     list.Add(*bw::first_active_ai_script);
     wait = 0;
+    script_timers.Add(this);
     town = nullptr;
     if (area_)
     {
@@ -196,25 +395,18 @@ Script::Script(uint32_t player_, uint32_t pos_, bool bwscript, const Rect32 *are
 
 Script::~Script()
 {
+    script_timers.Remove(this);
     list.Remove(*bw::first_active_ai_script);
 }
 
 void ProgressScripts()
 {
-    Script *script = *bw::first_active_ai_script, *next;
-    while (script)
-    {
-        Assert(bw::players[script->player].type == 1 || !script->town);
-        next = script->list.next;
-        if (script->wait-- == 0)
-        {
-            if (script->flags & 0x4)
-                delete script;
-            else
-                bw::ProgressAiScript(script);
-        }
-        script = next;
-    }
+    script_timers.Progress();
+}
+
+void UpdateScriptWaits()
+{
+    script_timers.WriteWaits();
 }
 
 void RemoveTownGasReferences(Unit *unit)
@@ -251,6 +443,7 @@ void RemoveUnitAi(Unit *unit, bool was_killed)
 
         ai->parent = nullptr;
         ai->list.Change(bw::first_guard_ai[unit->player], needed_guards[unit->player]);
+        WakeGuardNeeds(unit->player);
     }
     MedicRemove(unit);
     unit->ai = nullptr;
@@ -273,6 +466,7 @@ void PreCreateGuardAi(uint8_t player, uint16_t unit_id, uint16_t x, uint16_t y)
 {
     GuardAi *ai = CreateGuardAi(player, 0, unit_id, Point(x, y));
     ai->list.Add(needed_guards[player]);
+    WakeGuardNeeds(player);
 }
 
 void AddGuardAiToUnit(Unit *unit)
@@ -330,6 +524,35 @@ static bool DeleteGuardAiRequests(GuardAi *ai, int player)
     return false;
 }
 
+/// Guards are requested again once elapsed_seconds is past this
+static uint32_t GuardRespawnTime(const GuardAi *ai)
+{
+    if (ai->times_died == 0)
+        return ai->previous_update + 300;
+
+    UnitType unit_id(ai->unit_id);
+    if (unit_id == UnitId::SiegeTank_Sieged)
+        unit_id = UnitId::SiegeTankTankMode;
+    uint32_t time = unit_id.BuildTime();
+    switch (unit_id.Raw())
+    {
+        case UnitId::Guardian:
+        case UnitId::Devourer:
+            time += UnitId::Mutalisk.BuildTime();
+        break;
+        case UnitId::Hydralisk:
+            time += UnitId::Hydralisk.BuildTime();
+        break;
+        case UnitId::Archon:
+            time += UnitId::HighTemplar.BuildTime();
+        break;
+        case UnitId::DarkArchon:
+            time += UnitId::DarkTemplar.BuildTime();
+        break;
+    }
+    return ai->previous_update + time / 15 + 5;
+}
+
 void UpdateGuardNeeds(int player)
 {
     GuardAi *ai = bw::first_guard_ai[player];
@@ -346,10 +569,26 @@ void UpdateGuardNeeds(int player)
         }
         ai = next;
     }
+
+    bool delete_died_thrice = bw::player_ai[player].flags & 0x20;
+    GuardNeedsWakeup &wakeup = guard_needs_wakeup[player];
+    if (*bw::elapsed_seconds < wakeup.time && !(delete_died_thrice && wakeup.has_died_thrice))
+    {
+        if (Debug)
+        {
+            for (GuardAi *ai : needed_guards[player])
+                Assert(ai->previous_update != 0 && *bw::elapsed_seconds <= GuardRespawnTime(ai));
+        }
+        return;
+    }
+    // Guards added during the loop reset this to 0
+    wakeup.time = UINT32_MAX;
+    uint32_t next_wakeup = UINT32_MAX;
+    bool has_died_thrice = false;
     for (GuardAi *ai = needed_guards[player]; ai != nullptr; ai = next)
     {
         next = ai->list.next;
-        if (bw::player_ai[player].flags & 0x20 && ai->times_died >=3)
+        if (delete_died_thrice && ai->times_died >=3)
         {
             DeleteGuardAiRequests(ai, player);
             ai->list.Remove(needed_guards[player]);
@@ -357,39 +596,16 @@ void UpdateGuardNeeds(int player)
         }
         else
         {
+            if (ai->times_died >= 3)
+                has_died_thrice = true;
             if (ai->previous_update)
             {
-                uint32_t time;
-                if (ai->times_died != 0)
-                {
-                    UnitType unit_id(ai->unit_id);
-                    if (unit_id == UnitId::SiegeTank_Sieged)
-                        unit_id = UnitId::SiegeTankTankMode;
-                    time = unit_id.BuildTime();
-                    switch (unit_id.Raw())
-                    {
-                        case UnitId::Guardian:
-                        case UnitId::Devourer:
-                            time += UnitId::Mutalisk.BuildTime();
-                        break;
-                        case UnitId::Hydralisk:
-                            time += UnitId::Hydralisk.BuildTime();
-                        break;
-                        case UnitId::Archon:
-                            time += UnitId::HighTemplar.BuildTime();
-                        break;
-                        case UnitId::DarkArchon:
-                            time += UnitId::DarkTemplar.BuildTime();
-                        break;
-                    }
-                    time = ai->previous_update + time / 15 + 5;
-                }
-                else
-                {
-                    time = ai->previous_update + 300;
-                }
+                uint32_t time = GuardRespawnTime(ai);
                 if (*bw::elapsed_seconds <= time)
+                {
+                    next_wakeup = std::min(next_wakeup, time + 1);
                     continue;
+                }
             }
             Region *region = GetAiRegion(player, ai->unk_pos);
             if (region->state != 3 && !region->air_target && !region->ground_target && !(region->flags & 0x20))
@@ -413,9 +629,19 @@ void UpdateGuardNeeds(int player)
                 }
                 bw::Ai_GuardRequest(ai, player);
                 ai->previous_update = *bw::elapsed_seconds;
+                next_wakeup = std::min(next_wakeup, GuardRespawnTime(ai) + 1);
+            }
+            else
+            {
+                next_wakeup = 0;
             }
         }
     }
+    if (wakeup.time != 0)
+    {
+        wakeup.time = next_wakeup;
+        wakeup.has_died_thrice = has_died_thrice;
+    }
 }
 
 void DeleteGuardNeeds(int player)
@@ -428,6 +654,14 @@ void DeleteGuardNeeds(int player)
         delete ai;
     }
     needed_guards[player] = nullptr;
+    WakeGuardNeeds(player);
+}
+
+void ResetTimers()
+{
+    script_timers.Rebuild();
+    for (unsigned i = 0; i < Limits::ActivePlayers; i++)
+        WakeGuardNeeds(i);
 }
 
 WorkerAi::WorkerAi()
@@ -680,6 +914,7 @@ void DeleteAll()
     {
         DeleteGuardNeeds(i);
     }
+    ResetTimers();
 }
 
 void SetSuicideTarget(Unit *unit)
@@ -853,6 +1088,7 @@ int AddToRegionMilitary(Region *region, int unit_id, int unkx6)
         old_region = GetAiRegion(ai->parent); // But this is not necessarily same?
         AddMilitaryAi(ai->parent, region, true);
         ai->list.Change(bw::first_guard_ai[player], needed_guards[player]);
+        WakeGuardNeeds(player);
         ai->parent = 0;
     }
     else if (base_ai->type == 4)
@@ -897,6 +1133,7 @@ void ForceGuardAiRefresh(uint8_t player, uint16_t unit_id)
         if (UnitType(unit_id) != ai_unit_id)
             continue;
         ai->previous_update = 1;
+        WakeGuardNeeds(player);
     }
 }
 
@@ -1144,6 +1381,7 @@ void SuicideMission(int player, uint8_t random)
                 GuardAi *ai = (GuardAi *)unit->ai;
                 ai->parent = nullptr;
                 ai->list.Change(bw::first_guard_ai[player], needed_guards[player]);
+                WakeGuardNeeds(player);
                 Region *region = GetAiRegion(unit);
                 AddMilitaryAi(unit, region, true);
             }
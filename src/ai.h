@@ -284,6 +284,11 @@ namespace Ai
     bool ShouldCancelDamaged(const Unit *unit);
     void RemoveUnitAi(Unit *unit, bool unk);
     void ProgressScripts();
+    /// ProgressScripts only updates Script::wait of the scripts it runs,
+    /// this sets the others to their actual values.
+    void UpdateScriptWaits();
+    /// Has to be called after ai scripts and guards have been loaded from a save.
+    void ResetTimers();
 
     bool UpdateAttackTarget(Unit *unit, bool accept_if_sieged, bool accept_critters, bool must_reach);
     // Originally this was part of ReactToHit, but now it is called from Bullet::HitUnit,
@@ -1,6 +1,8 @@
 #include "ai_hit_reactions.h"
 
 #include <windows.h>
+#include <algorithm>
+#include <atomic>
 
 #include "constants/order.h"
 #include "constants/unit.h"
@@ -14,8 +16,10 @@
 #include "pathing.h"
 #include "perfclock.h"
 #include "player.h"
+#include "scthread.h"
 #include "unit.h"
 #include "unitsearch.h"
+#include "warn.h"
 #include "yms.h"
 
 using std::get;
@@ -41,6 +45,48 @@ class BestPickedTarget
 };
 
 
+void TargetEvaluation::Evaluate(const Unit *own, Unit *attacker)
+{
+    own_flags = own->flags;
+    attacker_flags = attacker->flags;
+    attacker_target = attacker->target;
+    own_order = own->order;
+    attacker_order = attacker->order;
+    can_attack = own->CanAttackUnit(attacker, true);
+    // Only needed by UpdatePickedTarget, which is not called if the unit cannot attack
+    valid_previous_attacker = false;
+    if (can_attack)
+    {
+        const UpdateAttackTargetContext ctx(own, true, own->order == OrderId::Pickup4);
+        valid_previous_attacker = ctx.CheckPreviousAttackerValid(attacker) != nullptr;
+    }
+}
+
+bool TargetEvaluation::IsCurrent(const Unit *own, const Unit *attacker) const
+{
+    return own->flags == own_flags && attacker->flags == attacker_flags && attacker->target == attacker_target &&
+        own->order == own_order && attacker->order == attacker_order;
+}
+
+bool TargetEvaluation::operator==(const TargetEvaluation &other) const
+{
+    return can_attack == other.can_attack && valid_previous_attacker == other.valid_previous_attacker &&
+        own_flags == other.own_flags && attacker_flags == other.attacker_flags &&
+        attacker_target == other.attacker_target && own_order == other.own_order &&
+        attacker_order == other.attacker_order;
+}
+
+void EvaluateTargets(const vector<tuple<Unit *, Unit *>> &pairs, vector<TargetEvaluation> *out)
+{
+    STATIC_PERF_CLOCK(Ai_EvaluateTargets);
+    out->resize(pairs.size());
+    TargetEvaluation *results = out->data();
+    threads->ParallelFor(pairs.size(), 64, 2, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+            results[i].Evaluate(get<1>(pairs[i]), get<0>(pairs[i]));
+    });
+}
+
 static bool IsUsableSpellOrder(OrderType order)
 {
     using namespace OrderId;
@@ -70,6 +116,7 @@ void HitReactions::Reset()
     region_enemy_strength_updates.clear();
     region_enemy_strength_updates.resize(region_count * Limits::ActivePlayers, 0);
     helpers.clear();
+    helper_evaluations.clear();
     update_attack_targets.clear();
     is_valid = true;
 }
@@ -318,11 +365,16 @@ bool HitReactions::UnitWasHit(Unit *own, Unit *attacker, bool important_hit, boo
     return false;
 }
 
-void HitReactions::UpdatePickedTarget(Unit *own, Unit *attacker)
+void HitReactions::UpdatePickedTarget(Unit *own, Unit *attacker, const TargetEvaluation *eval)
 {
     const UpdateAttackTargetContext ctx(own, true, own->order == OrderId::Pickup4);
 
-    if (ctx.CheckPreviousAttackerValid(attacker) != nullptr)
+    bool valid;
+    if (eval != nullptr)
+        valid = eval->valid_previous_attacker;
+    else
+        valid = ctx.CheckPreviousAttackerValid(attacker) != nullptr;
+    if (valid)
     {
         BestPickedTarget picked_target(own);
         Unit *previous_picked = picked_target.GetPicked();
@@ -332,7 +384,7 @@ void HitReactions::UpdatePickedTarget(Unit *own, Unit *attacker)
     }
 }
 
-void HitReactions::React(Unit *own, Unit *attacker, bool important_hit)
+void HitReactions::React(Unit *own, Unit *attacker, bool important_hit, const TargetEvaluation *eval)
 {
     bool uninterruptable = own->IsInUninterruptableState();
     if (uninterruptable && !important_hit)
@@ -370,9 +422,12 @@ void HitReactions::React(Unit *own, Unit *attacker, bool important_hit)
     if (uninterruptable)
         return;
 
-    if (own->CanAttackUnit(attacker, true))
+    if (eval != nullptr && !eval->IsCurrent(own, attacker))
+        eval = nullptr;
+    bool can_attack = eval != nullptr ? eval->can_attack : own->CanAttackUnit(attacker, true);
+    if (can_attack)
     {
-        UpdatePickedTarget(own, attacker);
+        UpdatePickedTarget(own, attacker, eval);
     }
     else if (own->ai)
     {
@@ -397,11 +452,12 @@ void HitReactions::React(Unit *own, Unit *attacker, bool important_hit)
     return;
 }
 
-void HitReactions::AddReaction(Unit *own, Unit *attacker, bool important_hit, bool call_help)
+void HitReactions::AddReaction(Unit *own, Unit *attacker, bool important_hit, bool call_help,
+                               const TargetEvaluation *eval)
 {
     bool skip = UnitWasHit(own, attacker, important_hit, call_help);
     if (!skip) {
-        React(own, attacker, important_hit);
+        React(own, attacker, important_hit, eval);
     }
 }
 
@@ -438,11 +494,15 @@ void HitReactions::ProcessAskForHelp()
             return get<0>(a)->lookup_id < get<0>(b)->lookup_id; // Enemy
         return get<1>(a)->lookup_id < get<1>(b)->lookup_id;
     });
-    for (const auto &pair : helpers.Unique())
+    helpers.erase(std::unique(helpers.begin(), helpers.end()), helpers.end());
+    // The checks are done in parallel, but the reactions have to be done in order,
+    // as they issue orders and change ai regions
+    EvaluateTargets(helpers, &helper_evaluations);
+    for (unsigned i = 0; i < helpers.size(); i++)
     {
-        Unit *enemy = get<0>(pair);
-        Unit *helper = get<1>(pair);
-        AddReaction(helper, enemy, false, false);
+        Unit *enemy = get<0>(helpers[i]);
+        Unit *helper = get<1>(helpers[i]);
+        AddReaction(helper, enemy, false, false, &helper_evaluations[i]);
     }
 }
 
@@ -480,8 +540,28 @@ void HitReactions::UpdateRegionEnemyStrengths()
             if (region_enemy_strength_updates[i + region_id] != 0)
             {
                 Region *region = bw::player_ai_regions[player] + region_id;
-                region->enemy_air_strength = bw::GetEnemyAirStrength(region_id, player);
-                region->enemy_ground_strength = bw::GetEnemyStrength(region_id, player, false);
+                // Usually the attacker has already left or died, in which case
+                // there is no need to have bw search for the units
+                if (!unit_search->HasOthersUnitsInRegion(region_id, player))
+                {
+                    if (Debug)
+                    {
+                        int air = bw::GetEnemyAirStrength(region_id, player);
+                        int ground = bw::GetEnemyStrength(region_id, player, false);
+                        if (air != 0 || ground != 0)
+                        {
+                            Warning("Region %x has no enemies of player %d, yet bw calculated strengths %d/%d",
+                                    region_id, player, air, ground);
+                        }
+                    }
+                    region->enemy_air_strength = 0;
+                    region->enemy_ground_strength = 0;
+                }
+                else
+                {
+                    region->enemy_air_strength = bw::GetEnemyAirStrength(region_id, player);
+                    region->enemy_ground_strength = bw::GetEnemyStrength(region_id, player, false);
+                }
             }
         }
     }
@@ -567,4 +647,40 @@ bool TestBestTargetPicking()
     return true;
 }
 
+/// Evaluates every ai unit against each of its enemies, both with EvaluateTargets
+/// and serially, and logs the first pair where the results differ.
+bool TestTargetEvaluation()
+{
+    vector<tuple<Unit *, Unit *>> pairs;
+    for (Unit *unit : *bw::first_active_unit)
+    {
+        if (!IsComputerPlayer(unit->player) || unit->ai == nullptr)
+            continue;
+        for (Unit *other : *bw::first_active_unit)
+        {
+            if (unit->IsEnemy(other))
+                pairs.emplace_back(other, unit);
+        }
+    }
+    vector<TargetEvaluation> parallel;
+    EvaluateTargets(pairs, &parallel);
+    for (unsigned i = 0; i < pairs.size(); i++)
+    {
+        Unit *enemy = get<0>(pairs[i]);
+        Unit *unit = get<1>(pairs[i]);
+        TargetEvaluation serial;
+        serial.Evaluate(unit, enemy);
+        if (!(serial == parallel[i]))
+        {
+            debug_log->Log("Target evaluation error for unit %08X (%p) attacked by %08X (%p): "
+                    "serial %d/%d, parallel %d/%d\n", unit->lookup_id, unit, enemy->lookup_id, enemy,
+                    serial.can_attack, serial.valid_previous_attacker,
+                    parallel[i].can_attack, parallel[i].valid_previous_attacker);
+            return false;
+        }
+    }
+    debug_log->Log("Target evaluation: %d pairs ok\n", (int)pairs.size());
+    return true;
+}
+
 } // namespace Ai
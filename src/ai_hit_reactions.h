@@ -25,6 +25,28 @@ struct ClearOnMoveBool
 
 namespace Ai
 {
+    /// Results of the read-only checks React does for an unit and its attacker, so they
+    /// can be done on other threads beforehand. The results are only used if the state
+    /// they depend on has not changed since, otherwise the checks are done again.
+    struct TargetEvaluation
+    {
+        void Evaluate(const Unit *own, Unit *attacker);
+        bool IsCurrent(const Unit *own, const Unit *attacker) const;
+        bool operator==(const TargetEvaluation &other) const;
+
+        bool can_attack;
+        bool valid_previous_attacker;
+
+        uint32_t own_flags;
+        uint32_t attacker_flags;
+        Unit *attacker_target;
+        uint8_t own_order;
+        uint8_t attacker_order;
+    };
+
+    /// Evaluates each (attacker, own) pair, using the thread pool if there are enough of them.
+    void EvaluateTargets(const vector<tuple<Unit *, Unit *>> &pairs, vector<TargetEvaluation> *out);
+
     /// Maintains some state caused by units getting hit, and only fully updates
     /// some ai region etc things when ProcessEverything is called (Or the state
     /// is destroyed)
@@ -63,18 +85,20 @@ namespace Ai
 
         private:
             /// Does both UnitWasHit and React. The distinction between those is somewhat arbitary.
-            void AddReaction(Unit *own, Unit *attacker, bool important_hit, bool call_help);
+            /// eval may be nullptr, see TargetEvaluation.
+            void AddReaction(Unit *own, Unit *attacker, bool important_hit, bool call_help,
+                             const TargetEvaluation *eval = nullptr);
             /// Updates/buffers for updating the ai-global state related to hitting units,
             /// and possibly orders nearby units to help
             /// Return true for early exit (transports unloading)
             bool UnitWasHit(Unit *own, Unit *attacker, bool important_hit, bool call_help);
             /// Does unit-specific reactions for the hit. Note: There are some cases when it modifies
             /// global ai state as well, at least with Ai_Detect.
-            void React(Unit *own, Unit *attacker, bool important_hit);
+            void React(Unit *own, Unit *attacker, bool important_hit, const TargetEvaluation *eval);
 
             /// Adds attacker to the list of possible new targets
             /// (Well, checks if it is better new target than the previously best)
-            void UpdatePickedTarget(Unit *own, Unit *attacker);
+            void UpdatePickedTarget(Unit *own, Unit *attacker, const TargetEvaluation *eval);
 
             /// Buffers helping unit-attacker pairs to the helpers vector.
             /// attacking_military causes only the military units which are part of
@@ -110,10 +134,13 @@ namespace Ai
             void ProcessAskForHelp();
             void ProcessUpdateAttackTarget();
             /// Updates the regions specified in region_enemy_strength_updates.
+            /// Regions which unit search knows to have no units of other players are set to 0
+            /// without asking bw (which is cross-checked in debug builds).
             void UpdateRegionEnemyStrengths();
 
             typedef vector<tuple<Unit *, Unit *>> HelpingUnitVec;
             HelpingUnitVec helpers;
+            vector<TargetEvaluation> helper_evaluations;
             std::deque<Unit *> update_attack_targets;
             vector<UnitList<Region *> *> ask_for_help_regions;
             vector<uint8_t> region_enemy_strength_updates;
@@ -122,6 +149,9 @@ namespace Ai
 
     /// For testing
     bool TestBestTargetPicking();
+    /// Checks that EvaluateTargets gives same results as evaluating serially,
+    /// for every ai unit and each of its enemies.
+    bool TestTargetEvaluation();
     Unit *GetBestTarget(Unit *unit, const vector<Unit *> &units);
 }
 #endif /* AI_HIT_REACTIONS_H */
@@ -228,7 +228,7 @@ bool Bullet::Initialize(Unit *spawner, int player_, int direction, WeaponType we
     // Yes, bw mixes bullet's images with spawner's unit code.
     // At least wraith's lasers actually depend on this behaviour.
     const char *desc = "Bullet::Initialize (First frame of bullet's animation modifies the unit who spawned it)";
-    UnitIscriptContext ctx(spawner, nullptr, desc, MainRng(), false);
+    UnitIscriptContext ctx(spawner, nullptr, desc, spawner->IscriptRng(), false);
     bool success = ((Flingy *)this)->Initialize(&ctx, weapon.Flingy(), player_, direction, pos);
     if (!success)
         return false;
@@ -240,6 +240,7 @@ bool Bullet::Initialize(Unit *spawner, int player_, int direction, WeaponType we
     flingy_flags |= 0x8;
     flags = 0;
     bounces_remaining = 0;
+    iscript_done = 0;
     // Bw calls State_Init here, it should just return instantly though as no iscript has been run
     order_signal = 0;
     auto spin = weapon.LaunchSpin();
@@ -882,30 +883,27 @@ void Bullet::NormalHit(ProgressBulletBufs *bufs)
 }
 
 template <bool air_splash>
-void Bullet::Splash(ProgressBulletBufs *bufs, bool hit_own_units)
+void Bullet::Splash(ProgressBulletBufs *bufs, bool hit_own_units, SplashTargets::Target *targets,
+        SplashTargets::Target *targets_end)
 {
-    int outer_splash = Type().OuterSplash();
-    Rect16 splash_area(sprite->position, outer_splash);
-
-    int unit_amount;
-    Unit **units, **units_beg;
-    units = units_beg = unit_search->FindUnitsRect(splash_area, &unit_amount);
+    // SplashTargets already skipped units further than outer splash
     bool hit_orig = false;
     bool storm = Type() == WeaponId::PsiStorm;
-    Unit **rand_fulldmg_pos = units;
+    SplashTargets::Target *pos = targets;
+    SplashTargets::Target *rand_fulldmg_pos = targets;
     if (air_splash)
     {
-        for (Unit *unit = *units++; unit; unit = *units++)
+        while (pos != targets_end)
         {
+            Unit *unit = pos->unit;
+            int distance = pos->distance;
+            pos++;
             if (!hit_own_units && unit->player == player && unit != target)
                 continue;
             if (!bw::CanHitUnit(unit, unit, weapon_id))
                 continue;
             if (!storm && unit == parent)
                 continue;
-            int distance = GetSplashDistance(this, unit);
-            if (distance > outer_splash)
-                continue;
             if (storm)
             {
                 if (unit->is_under_storm)
@@ -924,12 +922,12 @@ void Bullet::Splash(ProgressBulletBufs *bufs, bool hit_own_units)
                 }
                 else
                 {
-                    *rand_fulldmg_pos++ = unit;
+                    (rand_fulldmg_pos++)->unit = unit;
                 }
             }
             else if (unit->Type() != UnitId::Interceptor) // Yeah..
             {
-                *rand_fulldmg_pos++ = unit;
+                (rand_fulldmg_pos++)->unit = unit;
 
                 if (distance <= Type().MiddleSplash())
                     HitUnit(unit, damage / 2, bufs);
@@ -940,17 +938,16 @@ void Bullet::Splash(ProgressBulletBufs *bufs, bool hit_own_units)
     }
     if (!air_splash || hit_orig) // Simpler copy from previous loop
     {
-        for (Unit *unit = *units++; unit; unit = *units++)
+        for (; pos != targets_end; pos++)
         {
+            Unit *unit = pos->unit;
+            int distance = pos->distance;
             if (!hit_own_units && unit->player == player && unit != target)
                 continue;
             if (!bw::CanHitUnit(unit, unit, weapon_id))
                 continue;
             if (!storm && unit == parent)
                 continue;
-            int distance = GetSplashDistance(this, unit);
-            if (distance > outer_splash)
-                continue;
             if (storm)
             {
                 if (unit->is_under_storm)
@@ -971,50 +968,103 @@ void Bullet::Splash(ProgressBulletBufs *bufs, bool hit_own_units)
                 HitUnit(unit, damage / 4, bufs);
         }
     }
-    else if (air_splash && rand_fulldmg_pos != units_beg)
+    else if (air_splash && rand_fulldmg_pos != targets)
     {
-        int count = rand_fulldmg_pos - units_beg;
-        Unit *fulldmg = units_beg[MainRng()->Rand(count)];
+        int count = rand_fulldmg_pos - targets;
+        Unit *fulldmg = targets[MainRng()->Rand(count)].unit;
         int damage = GetWeaponDamage(this, fulldmg);
         HitUnit(fulldmg, damage, bufs);
     }
-    unit_search->PopResult();
 }
 
-void Bullet::Splash_Lurker(ProgressBulletBufs *bufs)
+void Bullet::Splash_Lurker(ProgressBulletBufs *bufs, SplashTargets::Target *targets, SplashTargets::Target *targets_end)
 {
-    // Yea inner splash (Even though they are same for default)
-    auto area = Rect16(sprite->position, Type().InnerSplash());
-    unit_search->ForEachUnitInArea(area, [this, bufs](Unit *unit)
+    // Yea inner splash (Even though they are same for default), SplashTargets already
+    // skipped units further than that
+    for (SplashTargets::Target *pos = targets; pos != targets_end; pos++)
     {
+        Unit *unit = pos->unit;
         if (unit->player == player && unit != target)
-            return false;
+            continue;
         if (!bw::CanHitUnit(unit, unit, weapon_id)) // attacker is target.. well does not matter
-            return false;
-        if (GetSplashDistance(this, unit) > Type().InnerSplash())
-            return false;
+            continue;
 
         if (parent)
         {
+            bool already_hit = false;
             for (auto hits : bw::lurker_hits)
             {
                 for (auto hit : hits)
                 {
                     if (hit[0] == parent && hit[1] == unit)
-                    return false;
+                        already_hit = true;
                 }
             }
-            int pos = *bw::lurker_hits_used;
-            if (pos != 0x10)
+            if (already_hit)
+                continue;
+            int hit_pos = *bw::lurker_hits_used;
+            if (hit_pos != 0x10)
             {
-                bw::lurker_hits[*bw::lurker_hits_pos][pos][0] = parent;
-                bw::lurker_hits[*bw::lurker_hits_pos][pos][1] = unit;
-                *bw::lurker_hits_used = pos + 1;
+                bw::lurker_hits[*bw::lurker_hits_pos][hit_pos][0] = parent;
+                bw::lurker_hits[*bw::lurker_hits_pos][hit_pos][1] = unit;
+                *bw::lurker_hits_used = hit_pos + 1;
             }
         }
         HitUnit(unit, GetWeaponDamage(this, unit), bufs);
-        return false;
-    });
+    }
+}
+
+int Bullet::SplashRadius() const
+{
+    switch (Type().Effect())
+    {
+        case 0x2:
+        case 0x3:
+        case 0x5:
+            if (Type() == WeaponId::SubterraneanSpines)
+                return Type().InnerSplash();
+            else
+                return Type().OuterSplash();
+        case 0x18:
+            return Type().OuterSplash();
+        default:
+            return -1;
+    }
+}
+
+void SplashTargets::Find(const UnsortedList<Bullet *> &bullets)
+{
+    STATIC_PERF_CLOCK(SplashTargets_Find);
+    areas.clear();
+    for (Bullet *bullet : bullets)
+    {
+        int radius = bullet->SplashRadius();
+        if (radius >= 0)
+            areas.emplace_back(bullet->sprite->position, radius);
+    }
+    unit_search->FindUnitsRects(areas, &area_units, &area_offsets);
+
+    targets.clear();
+    offsets.clear();
+    uint32_t area = 0;
+    for (Bullet *bullet : bullets)
+    {
+        offsets.emplace_back(targets.size());
+        int radius = bullet->SplashRadius();
+        if (radius < 0)
+            continue;
+        for (uint32_t i = area_offsets[area]; i < area_offsets[area + 1]; i++)
+        {
+            Unit *unit = area_units[i];
+            int distance = GetSplashDistance(bullet, unit);
+            if (distance <= radius)
+                targets.push_back(Target { unit, distance });
+        }
+        area++;
+    }
+    offsets.emplace_back(targets.size());
+    impact_count = areas.size();
+    candidate_count = area_units.size();
 }
 
 void Bullet::AcidSporeHit() const
@@ -1041,7 +1091,8 @@ void Bullet::SpawnBroodlingHit(vector<Unit *> *killed_units) const
     parent->IncrementKills();
 }
 
-tuple<Optional<SpellCast>, bool> Bullet::DoMissileDmg(ProgressBulletBufs *bufs)
+tuple<Optional<SpellCast>, bool> Bullet::DoMissileDmg(ProgressBulletBufs *bufs,
+        SplashTargets::Target *splash_targets, SplashTargets::Target *splash_targets_end)
 {
     auto scourge_exe_edit_remove = false;
     auto spellcast = Optional<SpellCast>();
@@ -1060,12 +1111,12 @@ tuple<Optional<SpellCast>, bool> Bullet::DoMissileDmg(ProgressBulletBufs *bufs)
         case 0x3:
         case 0x5:
             if (Type() == WeaponId::SubterraneanSpines)
-                Splash_Lurker(bufs);
+                Splash_Lurker(bufs, splash_targets, splash_targets_end);
             else
-                Splash<false>(bufs, effect != 0x3);
+                Splash<false>(bufs, effect != 0x3, splash_targets, splash_targets_end);
         break;
         case 0x18:
-            Splash<true>(bufs, false);
+            Splash<true>(bufs, false, splash_targets, splash_targets_end);
         break;
         case 0x4:
             if (target && !target->IsDying())
@@ -1239,17 +1290,49 @@ class BulletIscriptContext : public Iscript::Context
         }
 };
 
+/// Most bullets' iscripts are just waiting on any given frame, which only touches the bullet's
+/// own images, so those are progressed here in parallel. Bullets which have commands to execute
+/// are left for ProgressStates, which runs them in container order, as they use the rng and
+/// may spawn sprites.
+void BulletSystem::ProgressWaitingIscripts()
+{
+    STATIC_PERF_CLOCK(BulletSystem_ProgressWaitingIscripts);
+    iscript_bullets.clear();
+    for (Bullet *bullet : ActiveBullets())
+        iscript_bullets.emplace_back(bullet);
+    std::atomic<uint32_t> done_bullets(0);
+    threads->ParallelFor(iscript_bullets.size(), 256, 4, [&](uint32_t begin, uint32_t end) {
+        uint32_t done = 0;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            Bullet *bullet = iscript_bullets[i];
+            bullet->iscript_done = bullet->sprite->ProgressWaitingImages();
+            done += bullet->iscript_done;
+        }
+        if (PerfTest)
+            done_bullets.fetch_add(done, std::memory_order_relaxed);
+    });
+    if (PerfTest)
+    {
+        perf_log->Log("Bullet iscripts: %u of %u only waiting\n",
+                done_bullets.load(std::memory_order_relaxed), (uint32_t)iscript_bullets.size());
+    }
+}
+
 Claimed<BulletStateResults> BulletSystem::ProgressStates()
 {
     auto results = state_results_buf.Claim();
     results->clear();
     BulletStateResults *results_ptr = &results.Inner();
+    ProgressWaitingIscripts();
     for (BulletContainer::entry bullet_it : ActiveBullets_Entries())
     {
         Bullet *bullet = bullet_it->get();
         bullet->sprite->UpdateVisibilityPoint();
+        if (bullet->iscript_done)
+            continue;
 
-        BulletIscriptContext ctx(bullet, results_ptr, "BulletSystem::ProgressStates", MainRng(), true);
+        BulletIscriptContext ctx(bullet, results_ptr, "BulletSystem::ProgressStates", bullet->IscriptRng(), true);
         ctx.ProgressIscript();
         if (ctx.CheckDeleted())
             DeleteBullet(&bullet_it);
@@ -1317,10 +1400,14 @@ void BulletSystem::ProgressFrames(BulletFramesInput input)
     spells->clear();
     killed_units->clear();
     bulletframes_in_progress = true;
+    splash_targets.Find(state_results->do_missile_dmgs);
+    uint32_t bullet_index = 0;
     for (Bullet *bullet : state_results->do_missile_dmgs)
     {
         auto parent = bullet->parent;
-        auto result = bullet->DoMissileDmg(&bufs);
+        auto result = bullet->DoMissileDmg(&bufs, splash_targets.Begin(bullet_index),
+                splash_targets.End(bullet_index));
+        bullet_index += 1;
         auto &spell = get<0>(result);
         if (spell)
             spells->emplace_back(move(spell.take()));
@@ -1420,6 +1507,11 @@ void BulletSystem::ProgressFrames(BulletFramesInput input)
 
     perf_log->Log("Pbf: %f ms + Ph %f ms + Puwh %f ms + Ahr %f ms + Clean %f ms = about %f ms\n", pbf_time, ph_time, puwh_time, ahr_time, clock.GetTime(), clock2.GetTime());
     perf_log->Log("Sleep count: %d\n", threads->GetSleepCount() - prev_sleep);
+    if (splash_targets.ImpactCount() != 0)
+    {
+        perf_log->Log("Splash: %u impacts, %u candidates tested (%.1f per impact)\n", splash_targets.ImpactCount(),
+                splash_targets.CandidateCount(), (double)splash_targets.CandidateCount() / splash_targets.ImpactCount());
+    }
     perf_log->Indent(2);
     StaticPerfClock::LogCalls();
     perf_log->Indent(-2);
@@ -1440,9 +1532,14 @@ void RemoveFromBulletTargets(Unit *unit)
     unit->spawned_bullets = nullptr;
 }
 
+Rng *Bullet::IscriptRng()
+{
+    return sprite->rng_stream.Get(ObjectRng::Bullet, sprite->id);
+}
+
 void Bullet::SetIscriptAnimation(int anim, bool force, const char *caller, BulletStateResults *results)
 {
-    BulletIscriptContext(this, results, caller, MainRng(), false).SetIscriptAnimation(anim, force);
+    BulletIscriptContext(this, results, caller, IscriptRng(), false).SetIscriptAnimation(anim, force);
 }
 
 void Bullet::WarnUnhandledIscriptCommand(const Iscript::Command &cmd, const char *func) const
@@ -138,6 +138,39 @@ struct BulletStateResults
     }
 };
 
+/// Units which may be hit by the splashes of a frame. All bullets doing missile damage are
+/// searched at once with MainUnitSearch::FindUnitsRects before any damage is done, which is
+/// fine as units do not move until the damage has been applied. Only the position checks are
+/// done here, everything else is still checked by Bullet::Splash in bullet order.
+class SplashTargets
+{
+    public:
+        struct Target
+        {
+            Unit *unit;
+            int distance;
+        };
+
+        SplashTargets() : impact_count(0), candidate_count(0) {}
+
+        void Find(const UnsortedList<Bullet *> &bullets);
+        /// Targets for the index-th bullet that was passed to Find(), in unit search order
+        Target *Begin(uint32_t index) { return targets.data() + offsets[index]; }
+        Target *End(uint32_t index) { return targets.data() + offsets[index + 1]; }
+
+        /// Amount of splashing bullets and units tested for them during the last Find()
+        uint32_t ImpactCount() const { return impact_count; }
+        uint32_t CandidateCount() const { return candidate_count; }
+
+    private:
+        vector<Target> targets;
+        vector<uint32_t> offsets;
+        vector<Rect16> areas;
+        vector<Unit *> area_units;
+        vector<uint32_t> area_offsets;
+        uint32_t impact_count;
+        uint32_t candidate_count;
+};
 
 #pragma pack(push)
 #pragma pack(1)
@@ -194,7 +227,9 @@ class Bullet
         Unit *parent; // 0x64
         Unit *previous_target;
         uint8_t spread_seed;
-        uint8_t padding[0x3];
+        // Set by BulletSystem::ProgressWaitingIscripts if the bullet's iscript was already progressed
+        uint8_t iscript_done;
+        uint8_t padding[0x2];
 
 
         ListEntry<Bullet, 0x70> targeting; // 0x70
@@ -215,7 +250,10 @@ class Bullet
         BulletState State_MoveToUnit(BulletStateResults *results);
         BulletState State_MoveNearUnit(BulletStateResults *results);
         // Bool is true for scourge exe edit hacksupport
-        tuple<Optional<SpellCast>, bool> DoMissileDmg(ProgressBulletBufs *bufs);
+        tuple<Optional<SpellCast>, bool> DoMissileDmg(ProgressBulletBufs *bufs,
+                SplashTargets::Target *splash_targets, SplashTargets::Target *splash_targets_end);
+        /// Distance from which DoMissileDmg hits units, or -1 if the weapon does not splash
+        int SplashRadius() const;
 
         void UpdateMoveTarget(const Point &target);
         void Move(const Point &where);
@@ -235,8 +273,9 @@ class Bullet
         void NormalHit(ProgressBulletBufs *bufs);
         void HitUnit(Unit *target, int dmg, ProgressBulletBufs *bufs);
         void AcidSporeHit() const;
-        template <bool air_splash> void Splash(ProgressBulletBufs *bufs, bool hit_own_units);
-        void Splash_Lurker(ProgressBulletBufs *bufs);
+        template <bool air_splash> void Splash(ProgressBulletBufs *bufs, bool hit_own_units,
+                SplashTargets::Target *targets, SplashTargets::Target *targets_end);
+        void Splash_Lurker(ProgressBulletBufs *bufs, SplashTargets::Target *targets, SplashTargets::Target *targets_end);
         void SpawnBroodlingHit(vector<Unit *> *killed_units) const;
 
         Unit *ChooseBounceTarget();
@@ -248,6 +287,8 @@ class Bullet
 
         // Results must not be null
         void SetIscriptAnimation(int anim, bool force, const char *caller, BulletStateResults *results);
+        /// Rng for the bullet's iscript, MainRng() unless object_rng_streams is enabled
+        Rng *IscriptRng();
 };
 
 /// Contains and controls bullets of the game
@@ -279,6 +320,7 @@ class BulletSystem
 
     private:
         Claimed<BulletStateResults> ProgressStates();
+        void ProgressWaitingIscripts();
         void ProcessHits(ProgressBulletBufs *bufs);
         vector<Unit *> ProcessUnitWasHit(vector<tuple<Unit *, Unit *>> hits, ProgressBulletBufs *bufs);
         void ProcessAiReactToHit(vector<tuple<Unit *, Unit *, bool>> input, Ai::HitReactions *hit_reactions);
@@ -316,6 +358,9 @@ class BulletSystem
 
         /// Filled by and returned from ProgressStates(),
         Claimable<BulletStateResults> state_results_buf;
+        /// Used by ProgressWaitingIscripts()
+        vector<Bullet *> iscript_bullets;
+        SplashTargets splash_targets;
 
     public:
         class ActiveBullets_ : public Common::Iterator<ActiveBullets_, Bullet *> {
@@ -0,0 +1,245 @@
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "scstring.h"
+
+// Kept free of game headers, as it is also used by tools/cmdbench.cpp
+
+namespace commands
+{
+    enum ScCommands
+    {
+        KeepAlive = 0x5,
+        Save = 0x6,
+        Load = 0x7,
+        Restart = 0x8,
+        Select = 0x9,
+        SelectionAdd = 0xa,
+        SelectionRemove = 0xb,
+        Build = 0xc,
+        Vision = 0xd,
+        Ally = 0xe,
+        GameSpeed = 0xf,
+        Pause = 0x10,
+        Resume = 0x11,
+        Cheat = 0x12,
+        Hotkey = 0x13,
+        RightClick = 0x14,
+        TargetedOrder = 0x15,
+        CancelBuild = 0x18,
+        CancelMorph = 0x19,
+        Stop = 0x1a,
+        CarrierStop = 0x1b,
+        ReaverStop = 0x1c,
+        Order_Nothing = 0x1d,
+        ReturnCargo = 0x1e,
+        Train = 0x1f,
+        CancelTrain = 0x20,
+        Cloak = 0x21,
+        Decloak = 0x22,
+        UnitMorph = 0x23,
+        Unsiege = 0x25,
+        Siege = 0x26,
+        TrainFighter = 0x27,
+        UnloadAll = 0x28,
+        Unload = 0x29,
+        MergeArchon = 0x2a,
+        HoldPosition = 0x2b,
+        Burrow = 0x2c,
+        Unburrow = 0x2d,
+        CancelNuke = 0x2e,
+        Lift = 0x2f,
+        Tech = 0x30,
+        CancelTech = 0x31,
+        Upgrade = 0x32,
+        CancelUpgrade = 0x33,
+        CancelAddon = 0x34,
+        BuildingMorph = 0x35,
+        Stim = 0x36,
+        Sync = 0x37,
+        VoiceEnable1 = 0x38, // Voice commands are unused, taken from beta
+        VoiceEnable2 = 0x39,
+        VoiceSquelch1 = 0x3a, // These two specify a player
+        VoiceSquelch2 = 0x3b,
+        StartGame = 0x3c,
+        DownloadPercentage = 0x3d,
+        ChangeGameSlot = 0x3e,
+        NewNetPlayer = 0x3f,
+        JoinedGame = 0x40,
+        ChangeRace = 0x41,
+        TeamGameTeam = 0x42,
+        UmsTeam = 0x43,
+        MeleeTeam = 0x44,
+        SwapPlayers = 0x45,
+        SavedData = 0x48,
+        BriefingStart = 0x54,
+        Latency = 0x55,
+        ReplaySpeed = 0x56,
+        LeaveGame = 0x57,
+        MinimapPing = 0x58,
+        MergeDarkArchon = 0x5a,
+        MakeGamePublic = 0x5b,
+        Chat = 0x5c,
+    };
+}
+
+/// Every command ProcessCommands handles, as
+/// X(id, length, replay command, handler call)
+/// Length 0 means that the length depends on the data, see CommandTable::VariableLength.
+/// Replay commands are the ones a replay contains, and they are ignored while watching one
+/// unless they come from the replay itself.
+/// The handler call is a statement that may use `data` and `replay_process`.
+#define SC_GAME_COMMANDS(X) \
+    X(KeepAlive, 1, false, Command_KeepAlive(data)) \
+    X(Sync, 7, false, Command_Sync(data)) \
+    X(Save, 0, true, Command_Save(data)) \
+    X(Load, 0, true, if (!IsMultiplayer()) { bw::Command_Load(data + 5); }) \
+    X(Restart, 1, true, bw::Command_Restart()) \
+    X(Select, 0, true, Command_Select(data)) \
+    X(SelectionAdd, 0, true, Command_SelectionAdd(data)) \
+    X(SelectionRemove, 0, true, Command_SelectionRemove(data)) \
+    X(Build, 8, true, bw::Command_Build(data)) \
+    X(TargetedOrder, 11, true, Command_Targeted(data)) \
+    X(MinimapPing, 5, true, bw::Command_MinimapPing(data)) \
+    X(RightClick, 10, true, Command_RightClick(data)) \
+    X(Vision, 3, true, bw::Command_Vision(data)) \
+    X(Ally, 5, true, bw::Command_Ally(data)) \
+    X(GameSpeed, 2, true, Command_GameSpeed(data)) \
+    X(Pause, 1, false, bw::Command_Pause()) \
+    X(Resume, 1, false, bw::Command_Resume()) \
+    X(Cheat, 5, true, bw::Command_Cheat(data)) \
+    X(Hotkey, 3, true, bw::Command_Hotkey(data)) \
+    X(CancelBuild, 1, true, bw::Command_CancelBuild()) \
+    X(CancelMorph, 1, true, bw::Command_CancelMorph()) \
+    X(Stop, 2, true, bw::Command_Stop(data)) \
+    X(CarrierStop, 1, true, bw::Command_CarrierStop()) \
+    X(ReaverStop, 1, true, bw::Command_ReaverStop()) \
+    X(Order_Nothing, 1, true, bw::Command_Order_Nothing()) \
+    X(ReturnCargo, 2, true, bw::Command_ReturnCargo(data)) \
+    X(Train, 3, true, bw::Command_Train(data)) \
+    X(CancelTrain, 3, true, bw::Command_CancelTrain(data)) \
+    X(Tech, 2, true, bw::Command_Tech(data)) \
+    X(CancelTech, 1, true, bw::Command_CancelTech()) \
+    X(Upgrade, 2, true, bw::Command_Upgrade(data)) \
+    X(CancelUpgrade, 1, true, bw::Command_CancelUpgrade()) \
+    X(Burrow, 2, true, bw::Command_Burrow(data)) \
+    X(Unburrow, 2, true, bw::Command_Unburrow()) \
+    X(Cloak, 2, true, bw::Command_Cloak()) \
+    X(Decloak, 2, true, bw::Command_Decloak()) \
+    X(UnitMorph, 3, true, bw::Command_UnitMorph(data)) \
+    X(BuildingMorph, 3, true, bw::Command_BuildingMorph(data)) \
+    X(Unsiege, 2, true, bw::Command_Unsiege(data)) \
+    X(Siege, 2, true, bw::Command_Siege(data)) \
+    X(UnloadAll, 2, true, bw::Command_UnloadAll(data)) \
+    X(Unload, 5, true, Command_Unload(data)) \
+    X(MergeArchon, 1, true, bw::Command_MergeArchon()) \
+    X(MergeDarkArchon, 1, true, bw::Command_MergeDarkArchon()) \
+    X(HoldPosition, 2, true, bw::Command_HoldPosition(data)) \
+    X(CancelNuke, 1, true, bw::Command_CancelNuke()) \
+    X(Lift, 5, true, bw::Command_Lift(data)) \
+    X(TrainFighter, 1, true, bw::Command_TrainFighter()) \
+    X(CancelAddon, 1, true, bw::Command_CancelAddon()) \
+    X(Stim, 1, true, bw::Command_Stim()) \
+    X(Latency, 2, false, bw::Command_Latency(data)) \
+    X(ReplaySpeed, 10, false, Command_ReplaySpeed(data)) \
+    X(LeaveGame, 2, true, bw::Command_LeaveGame(data)) \
+    X(Chat, 82, true, Command_Chat(data, replay_process))
+
+/// Lobby commands, X(id, length). These are ignored by ProcessCommands.
+#define SC_LOBBY_COMMANDS(X) \
+    X(StartGame, 1) \
+    X(DownloadPercentage, 2) \
+    X(ChangeGameSlot, 6) \
+    X(NewNetPlayer, 8) \
+    X(JoinedGame, 18) \
+    X(ChangeRace, 3) \
+    X(TeamGameTeam, 2) \
+    X(UmsTeam, 2) \
+    X(MeleeTeam, 3) \
+    X(SwapPlayers, 3) \
+    X(SavedData, 13) \
+    X(MakeGamePublic, 1) \
+    X(BriefingStart, 5)
+
+/// Lengths and replay flags of commands by their id, generated from the lists above.
+/// Unknown commands are one byte long.
+class CommandTable
+{
+    public:
+        CommandTable()
+        {
+            for (int i = 0; i < 0x100; i++)
+            {
+                lengths[i] = 1;
+                replay_commands[i] = true;
+            }
+#define COMMAND_TABLE_GAME(id, length, replay_command, handler) \
+            lengths[commands::id] = length; \
+            replay_commands[commands::id] = replay_command;
+#define COMMAND_TABLE_LOBBY(id, length) \
+            lengths[commands::id] = length;
+            SC_GAME_COMMANDS(COMMAND_TABLE_GAME)
+            SC_LOBBY_COMMANDS(COMMAND_TABLE_LOBBY)
+#undef COMMAND_TABLE_GAME
+#undef COMMAND_TABLE_LOBBY
+        }
+
+        /// Returns -1 for invalid data
+        int Length(const uint8_t *data, int max_length) const
+        {
+            int length = lengths[data[0]];
+            if (length != 0)
+                return length;
+            return VariableLength(data, max_length);
+        }
+
+        bool IsReplayCommand(uint8_t command) const { return replay_commands[command]; }
+
+    private:
+        static int VariableLength(const uint8_t *data, int max_length)
+        {
+            switch (data[0])
+            {
+                case commands::Save: case commands::Load:
+                    return 5 + Sc_strlen((const char *)data + 5, max_length - 5, 0x1c, false, false);
+                case commands::Select: case commands::SelectionAdd: case commands::SelectionRemove:
+                {
+                    if (max_length < 6)
+                        return -1;
+                    // Checked here, as count * 4 could overflow
+                    uint32_t count;
+                    memcpy(&count, data + 2, sizeof count);
+                    if (count > (uint32_t)(max_length - 6) / 4)
+                        return -1;
+                    return count * 4 + 6;
+                }
+                default:
+                    return -1;
+            }
+        }
+
+        uint8_t lengths[0x100];
+        bool replay_commands[0x100];
+};
+
+/// Calls func(command, length) for each command in data, stopping at the first invalid one.
+/// Returns false if an invalid command was found.
+template <class Func>
+bool ForEachCommand(const CommandTable &table, const uint8_t *data, int data_length, Func func)
+{
+    while (data_length > 0)
+    {
+        int length = table.Length(data, data_length);
+        data_length -= length;
+        if (data_length < 0 || length <= 0)
+            return false;
+        func(data, length);
+        data += length;
+    }
+    return true;
+}
+
+#endif /* COMMAND_TABLE_H */
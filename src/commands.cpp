@@ -25,22 +25,6 @@ struct MapDl
 
 const int ProtocolVersion = 0xdaf0;
 
-static bool IsReplayCommand(uint8_t command)
-{
-    switch (command)
-    {
-        case commands::KeepAlive:
-        case commands::Pause:
-        case commands::Resume:
-        case commands::Sync:
-        case commands::Latency:
-        case commands::ReplaySpeed:
-            return false;
-        default:
-            return true;
-    }
-}
-
 void Command_GameData(const uint8_t *data, int net_player)
 {
     if (*bw::in_lobby || net_player != 0)
@@ -292,166 +276,63 @@ static void Command_ReplaySpeed(const uint8_t *buf)
 
 static void Command_Chat(const uint8_t *buf, bool replay_unk)
 {
-    char copy[129];
-    copy[128] = 0;
-    memcpy(copy, buf, 128);
+    // The command is 82 bytes, 2 bytes of header and 80 bytes of text
+    char copy[83];
+    copy[82] = 0;
+    memcpy(copy, buf, 82);
     bw::PrintText(copy + 2, replay_unk, copy[1]);
 }
 
+static const CommandTable command_table;
+
+typedef void (*CommandHandler)(const uint8_t *data, bool replay_process);
+
+#define COMMAND_HANDLER(id, length, replay_command, handler) \
+    static void Handle_##id(const uint8_t *data, bool replay_process) { handler; }
+SC_GAME_COMMANDS(COMMAND_HANDLER)
+#undef COMMAND_HANDLER
+
+/// Handler functions by command id, nullptr for commands ProcessCommands ignores
+class CommandHandlers
+{
+    public:
+        CommandHandlers()
+        {
+            for (auto &handler : handlers)
+                handler = nullptr;
+#define COMMAND_HANDLER(id, length, replay_command, handler) \
+            handlers[commands::id] = &Handle_##id;
+            SC_GAME_COMMANDS(COMMAND_HANDLER)
+#undef COMMAND_HANDLER
+        }
+
+        CommandHandler handlers[0x100];
+};
+
+static const CommandHandlers command_handlers;
+
 /// Returns -1 for invalid data
 int CommandLength(const uint8_t *data, int max_length)
 {
-    switch (data[0])
-    {
-        case commands::KeepAlive: return 1;
-        case commands::Sync: return 7;
-        case commands::Save: case commands::Load:
-            return 5 + Sc_strlen((char *)data + 5, max_length - 5, 0x1c, false, false);
-        case commands::Restart: return 1;
-        case commands::Select: case commands::SelectionAdd: case commands::SelectionRemove:
-            if (max_length < 6)
-                return -1;
-            return SelectCommandLength(data);
-        case commands::Build: return 8;
-        case commands::TargetedOrder: return 11;
-        case commands::MinimapPing: return 5;
-        case commands::RightClick: return 10;
-        case commands::Vision: return 3;
-        case commands::Ally: return 5;
-        case commands::GameSpeed: return 2;
-        case commands::Pause: return 1;
-        case commands::Resume: return 1;
-        case commands::Cheat: return 5;
-        case commands::Hotkey: return 3;
-        case commands::CancelBuild: return 1;
-        case commands::CancelMorph: return 1;
-        case commands::Stop: return 2;
-        case commands::CarrierStop: return 1;
-        case commands::ReaverStop: return 1;
-        case commands::Order_Nothing: return 1;
-        case commands::ReturnCargo: return 2;
-        case commands::Train: return 3;
-        case commands::CancelTrain: return 3;
-        case commands::Tech: return 2;
-        case commands::CancelTech: return 1;
-        case commands::Upgrade: return 2;
-        case commands::CancelUpgrade: return 1;
-        case commands::Burrow: return 2;
-        case commands::Unburrow: return 2;
-        case commands::Cloak: return 2;
-        case commands::Decloak: return 2;
-        case commands::UnitMorph: return 3;
-        case commands::BuildingMorph: return 3;
-        case commands::Unsiege: return 2;
-        case commands::Siege: return 2;
-        case commands::UnloadAll: return 2;
-        case commands::Unload: return 5;
-        case commands::MergeArchon: return 1;
-        case commands::MergeDarkArchon: return 1;
-        case commands::HoldPosition: return 2;
-        case commands::CancelNuke: return 1;
-        case commands::Lift: return 5;
-        case commands::TrainFighter: return 1;
-        case commands::CancelAddon: return 1;
-        case commands::Stim: return 1;
-        case commands::Latency: return 2;
-        case commands::ReplaySpeed: return 10;
-        case commands::LeaveGame: return 2;
-        case commands::Chat: return 82;
-        case commands::StartGame: return 1;
-        case commands::DownloadPercentage: return 2;
-        case commands::ChangeGameSlot: return 6;
-        case commands::NewNetPlayer: return 8;
-        case commands::JoinedGame: return 18;
-        case commands::ChangeRace: return 3;
-        case commands::TeamGameTeam: return 2;
-        case commands::UmsTeam: return 2;
-        case commands::MeleeTeam: return 3;
-        case commands::SwapPlayers: return 3;
-        case commands::SavedData: return 13;
-        case commands::MakeGamePublic: return 1;
-        case commands::BriefingStart: return 5;
-        default: return 1;
-    }
+    return command_table.Length(data, max_length);
 }
 
 void ProcessCommands(const uint8_t *data, int data_length, int replay_process)
 {
-    while (data_length > 0)
-    {
-        uint8_t command = *data;
-        int length = CommandLength(data, data_length);
-        data_length -= length;
-        if (data_length < 0 || length <= 0)
-        {
-            const char *name = bw::players[*bw::select_command_user].name;
-            Warning("Player %d (%s) sent an invalid command", *bw::select_command_user, name);
+    bool skip_replay_commands = IsReplay() && !replay_process;
+    bool valid = ForEachCommand(command_table, data, data_length, [&](const uint8_t *cmd, int length) {
+        uint8_t command = cmd[0];
+        if (skip_replay_commands && command_table.IsReplayCommand(command))
             return;
-        }
-        if (IsReplay() && !replay_process && IsReplayCommand(command))
-        {
-            continue;
-        }
-        switch (command)
-        {
-            case commands::KeepAlive: Command_KeepAlive(data); break;
-            case commands::Sync: Command_Sync(data); break;
-            case commands::Save: Command_Save(data); break;
-            case commands::Load: if (!IsMultiplayer()) { bw::Command_Load(data + 5); } break;
-            case commands::Restart: bw::Command_Restart(); break;
-            case commands::Select: Command_Select(data); break;
-            case commands::SelectionAdd: Command_SelectionAdd(data); break;
-            case commands::SelectionRemove: Command_SelectionRemove(data); break;
-            case commands::Build: bw::Command_Build(data); break;
-            case commands::TargetedOrder: Command_Targeted(data); break;
-            case commands::MinimapPing: bw::Command_MinimapPing(data); break;
-            case commands::RightClick: Command_RightClick(data); break;
-            case commands::Vision: bw::Command_Vision(data); break;
-            case commands::Ally: bw::Command_Ally(data); break;
-            case commands::GameSpeed: Command_GameSpeed(data); break;
-            case commands::Pause: bw::Command_Pause(); break;
-            case commands::Resume: bw::Command_Resume(); break;
-            case commands::Cheat: bw::Command_Cheat(data); break;
-            case commands::Hotkey: bw::Command_Hotkey(data); break;
-            case commands::CancelBuild: bw::Command_CancelBuild(); break;
-            case commands::CancelMorph: bw::Command_CancelMorph(); break;
-            case commands::Stop: bw::Command_Stop(data); break;
-            case commands::CarrierStop: bw::Command_CarrierStop(); break;
-            case commands::ReaverStop: bw::Command_ReaverStop(); break;
-            case commands::Order_Nothing: bw::Command_Order_Nothing(); break;
-            case commands::ReturnCargo: bw::Command_ReturnCargo(data); break;
-            case commands::Train: bw::Command_Train(data); break;
-            case commands::CancelTrain: bw::Command_CancelTrain(data); break;
-            case commands::Tech: bw::Command_Tech(data); break;
-            case commands::CancelTech: bw::Command_CancelTech(); break;
-            case commands::Upgrade: bw::Command_Upgrade(data); break;
-            case commands::CancelUpgrade: bw::Command_CancelUpgrade(); break;
-            case commands::Burrow: bw::Command_Burrow(data); break;
-            case commands::Unburrow: bw::Command_Unburrow(); break;
-            case commands::Cloak: bw::Command_Cloak(); break;
-            case commands::Decloak: bw::Command_Decloak(); break;
-            case commands::UnitMorph: bw::Command_UnitMorph(data); break;
-            case commands::BuildingMorph: bw::Command_BuildingMorph(data); break;
-            case commands::Unsiege: bw::Command_Unsiege(data); break;
-            case commands::Siege: bw::Command_Siege(data); break;
-            case commands::UnloadAll: bw::Command_UnloadAll(data); break;
-            case commands::Unload: Command_Unload(data); break;
-            case commands::MergeArchon: bw::Command_MergeArchon(); break;
-            case commands::MergeDarkArchon: bw::Command_MergeDarkArchon(); break;
-            case commands::HoldPosition: bw::Command_HoldPosition(data); break;
-            case commands::CancelNuke: bw::Command_CancelNuke(); break;
-            case commands::Lift: bw::Command_Lift(data); break;
-            case commands::TrainFighter: bw::Command_TrainFighter(); break;
-            case commands::CancelAddon: bw::Command_CancelAddon(); break;
-            case commands::Stim: bw::Command_Stim(); break;
-            case commands::Latency: bw::Command_Latency(data); break;
-            case commands::ReplaySpeed: Command_ReplaySpeed(data); break;
-            case commands::LeaveGame: bw::Command_LeaveGame(data); break;
-            case commands::Chat: Command_Chat(data, replay_process); break;
-        }
-
-        bw::AddToReplayData(*bw::replay_data, *bw::lobby_command_user, data, length);
-        data += length;
+        CommandHandler handler = command_handlers.handlers[command];
+        if (handler != nullptr)
+            handler(cmd, replay_process);
+        bw::AddToReplayData(*bw::replay_data, *bw::lobby_command_user, cmd, length);
+    });
+    if (!valid)
+    {
+        const char *name = bw::players[*bw::select_command_user].name;
+        Warning("Player %d (%s) sent an invalid command", *bw::select_command_user, name);
     }
 }
 
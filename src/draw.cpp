@@ -38,6 +38,8 @@ void DrawScreen()
     const auto relaxed = std::memory_order_relaxed;
     // Overflowing is fine
     draw_counter.store(draw_counter.load(relaxed) + 1, relaxed);
+    if (headless_mode)
+        return;
 
     // The load screen code likes to draw screen after every grp loaded,
     // and this function is a lot slower than the original one
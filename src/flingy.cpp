@@ -1,5 +1,7 @@
 #include "flingy.h"
 
+#include <algorithm>
+
 #include "dat.h"
 #include "image.h"
 #include "offsets.h"
@@ -128,6 +130,100 @@ void Flingy::ProgressMove(FlingyMoveResults *ret)
     }
 }
 
+void FlingyMotionBatch::Clear()
+{
+    flingies.clear();
+    pos_x.clear();
+    pos_y.clear();
+    exact_x.clear();
+    exact_y.clear();
+    speed_x.clear();
+    speed_y.clear();
+    current_speed.clear();
+    waypoint_x.clear();
+    waypoint_y.clear();
+    flag_globals.clear();
+    moved_speed.clear();
+    finished = 0;
+}
+
+void FlingyMotionBatch::Add(Flingy *flingy)
+{
+    *bw::current_flingy_flags = flingy->flingy_flags;
+    bw::ChangeDirectionToMoveWaypoint(flingy);
+    bw::ProgressSpeed(flingy);
+    bw::UpdateIsMovingFlag(flingy);
+
+    bool moves = flingy->flingy_flags & 0x2 && flingy->current_speed != 0;
+    flingies.push_back(flingy);
+    pos_x.push_back(flingy->position.x);
+    pos_y.push_back(flingy->position.y);
+    exact_x.push_back(flingy->exact_position.x);
+    exact_y.push_back(flingy->exact_position.y);
+    speed_x.push_back(flingy->speed[0]);
+    speed_y.push_back(flingy->speed[1]);
+    current_speed.push_back(flingy->current_speed);
+    moved_speed.push_back(flingy->current_speed);
+    waypoint_x.push_back(moves ? (int32_t)flingy->next_move_waypoint.x : -1);
+    waypoint_y.push_back(moves ? (int32_t)flingy->next_move_waypoint.y : -1);
+    // ProgressMove has only read the values above before doing this
+    if (moves && flingy->flingy_movement_type == 2) // Iscript.bin
+        bw::SetSpeed(flingy, 0);
+
+    *bw::previous_flingy_flags = flingy->flingy_flags;
+    flingy->flingy_flags = *bw::current_flingy_flags;
+    flag_globals.push_back(*bw::previous_flingy_flags | *bw::show_endwalk_anim << 8 |
+            *bw::current_flingy_flags << 16 | *bw::show_startwalk_anim << 24);
+}
+
+void FlingyMotionBatch::Advance()
+{
+    STATIC_PERF_CLOCK(FlingyMotionBatch_Advance);
+    for (uint32_t i = finished; i < flingies.size(); i++)
+    {
+        if (waypoint_x[i] == -1)
+            continue;
+        int32_t waypoint_exact_x = waypoint_x[i] * 256 + 128;
+        int32_t waypoint_exact_y = waypoint_y[i] * 256 + 128;
+        int distance = Distance(Point32(exact_x[i], exact_y[i]), Point32(waypoint_exact_x, waypoint_exact_y));
+        if (distance <= current_speed[i])
+        {
+            exact_x[i] = waypoint_exact_x;
+            exact_y[i] = waypoint_exact_y;
+            moved_speed[i] = distance;
+        }
+        else
+        {
+            exact_x[i] += speed_x[i];
+            exact_y[i] += speed_y[i];
+        }
+        pos_x[i] = exact_x[i] >> 8;
+        pos_y[i] = exact_y[i] >> 8;
+    }
+}
+
+bool FlingyMotionBatch::Finish(const Flingy *flingy, FlingyMoveResults *ret)
+{
+    if (finished >= flingies.size() || flingies[finished] != flingy)
+    {
+        // The caller falls back to ProgressFlingy, which would change the speed and
+        // direction of a flingy that is in the batch a second time
+        Assert(std::find(flingies.begin(), flingies.end(), flingy) == flingies.end());
+        return false;
+    }
+    uint32_t i = finished++;
+    *bw::new_flingy_x = pos_x[i];
+    *bw::new_flingy_y = pos_y[i];
+    *bw::new_exact_x = exact_x[i];
+    *bw::new_exact_y = exact_y[i];
+    *bw::previous_flingy_flags = flag_globals[i] & 0xff;
+    *bw::show_endwalk_anim = (flag_globals[i] >> 8) & 0xff;
+    *bw::current_flingy_flags = (flag_globals[i] >> 16) & 0xff;
+    *bw::show_startwalk_anim = flag_globals[i] >> 24;
+    ret->moved_speed = moved_speed[i];
+    return true;
+}
+
 class FlingyIscriptContext : public Iscript::Context
 {
     public:
@@ -154,14 +250,14 @@ class FlingyIscriptContext : public Iscript::Context
 
 void Flingy::ProgressFrame()
 {
-    FlingyIscriptContext(this, MainRng()).ProgressIscript();
+    FlingyIscriptContext(this, sprite->IscriptRng()).ProgressIscript();
 
     ProgressFlingy();
     bw::MoveFlingy(this);
 
     if (sprite->position.x >= *bw::map_width || sprite->position.y >= *bw::map_height || move_target == position)
     {
-        FlingyIscriptContext(this, MainRng()).SetIscriptAnimation(Iscript::Animation::Death, true);
+        FlingyIscriptContext(this, sprite->IscriptRng()).SetIscriptAnimation(Iscript::Animation::Death, true);
     }
 }
 
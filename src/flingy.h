@@ -119,4 +119,45 @@ class Flingy
 };
 #pragma pack(pop)
 
+/// Progresses the movement of several flingies at once, with their motion state copied
+/// to packed arrays. Bw's direction and speed functions communicate through global
+/// variables, so they still run one flingy at a time in Add(), but the position advance
+/// of ProgressMove is then done for every flingy in a single loop.
+/// Finish() has to be called for each flingy in the order they were added, and it leaves
+/// the global variables as ProgressFlingy would have left them.
+class FlingyMotionBatch
+{
+    public:
+        FlingyMotionBatch() : finished(0) {}
+
+        void Clear();
+        /// Does the parts of ProgressFlingy which come before ProgressMove
+        void Add(Flingy *flingy);
+        /// Does ProgressMove for every added flingy
+        void Advance();
+        /// If flingy is the next flingy in the batch, sets the global variables and returns true.
+        /// Flingies which were not added have to use ProgressFlingy instead.
+        bool Finish(const Flingy *flingy, FlingyMoveResults *ret);
+
+        uint32_t Size() const { return flingies.size(); }
+
+    private:
+        vector<const Flingy *> flingies;
+        /// Positions, which Advance() replaces with the new positions
+        vector<int32_t> pos_x;
+        vector<int32_t> pos_y;
+        vector<int32_t> exact_x;
+        vector<int32_t> exact_y;
+        vector<int32_t> speed_x;
+        vector<int32_t> speed_y;
+        vector<int32_t> current_speed;
+        /// Next waypoint, or -1 if the flingy does not move this frame
+        vector<int32_t> waypoint_x;
+        vector<int32_t> waypoint_y;
+        /// Previous, current flags and the walking animation flags, as UpdateIsMovingFlag left them
+        vector<uint32_t> flag_globals;
+        vector<int32_t> moved_speed;
+        uint32_t finished;
+};
+
 #endif // FLINGY_H
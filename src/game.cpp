@@ -25,10 +25,16 @@
 unsigned int render_wait = 0;
 static bool force_render;
 float fps;
+bool headless_mode = false;
 const bool dont_pause_on_alttab = true;
+/// Sync test builds write the binary dump\sync.bin, which can be compared with tools/syncdiff.cpp.
+/// The old text dumps are a lot slower to write, but can be read without any tools.
+const bool text_sync_dump = false;
 bool all_visions = false;
 // Hack to reduce amount of unnecessarily hooked code, externed only in limits.cpp
 bool unitframes_in_progress = false;
+bool object_rng_streams = false;
+uint32_t object_rng_frame_seed = 0;
 
 void ForceRender()
 {
@@ -38,7 +44,58 @@ void ForceRender()
 GameTests *game_tests = nullptr;
 Score *score = nullptr;
 
+/// How long ProgressFrames may keep simulating before returning to bw's main loop in headless
+/// mode. Returning every now and then keeps window messages processed and the freeze logger happy.
+static const unsigned int HeadlessReturnWait = 250;
+
+struct HeadlessState
+{
+    uint32_t end_frame;
+    uint32_t start_frame;
+    uint64_t start_tick;
+    uint64_t frequency;
+    /// Frame times in performance counter ticks
+    uint64_t slowest_frame;
+    uint64_t total_object_time;
+    bool started;
+    bool muted_sound;
+};
+
+static HeadlessState headless;
+
+static uint64_t PerformanceCounter()
+{
+    LARGE_INTEGER value;
+    QueryPerformanceCounter(&value);
+    return value.QuadPart;
+}
+
+void EnableHeadlessMode(uint32_t end_frame)
+{
+    headless_mode = true;
+    headless = HeadlessState();
+    headless.end_frame = end_frame;
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    headless.frequency = frequency.QuadPart;
+    debug_log->Log("Headless mode enabled, end frame %d\n", end_frame);
+}
+
+static void StartHeadlessRun()
+{
+    headless.started = true;
+    headless.start_frame = *bw::frame_count;
+    headless.start_tick = PerformanceCounter();
+    // Sound is local-only, so muting does not affect the simulation
+    if (*bw::digital_volume != 0)
+    {
+        bw::ToggleSound();
+        headless.muted_sound = true;
+    }
+}
+
 static Optional<SyncData> old_sync;
+static ptr<SyncDumpWriter> sync_dump;
 
 static void ProgressAi()
 {
@@ -50,13 +107,23 @@ static void ProgressAi()
 
 static void DumpUnits()
 {
+    if (!text_sync_dump)
+    {
+        if (!sync_dump)
+        {
+            char filename[256];
+            snprintf(filename, sizeof filename, "%s\\dump\\sync.bin", log_path);
+            sync_dump.reset(new SyncDumpWriter(filename));
+        }
+        sync_dump->DumpFrame();
+        return;
+    }
     if (!unit_dump || *bw::frame_count % 1000 == 0)
     {
         delete unit_dump;
         char filename[256];
         sprintf(filename, "%s\\dump\\units_%d.txt", log_path, *bw::frame_count);
-        unit_dump = new DebugLog_Actual(filename);
-        unit_dump->AutoFlush(false);
+        unit_dump = new DebugLog_Actual(filename, LogMode::AsyncLossless);
     }
     SyncData sync;
     if (old_sync)
@@ -73,21 +140,9 @@ static void DumpUnits()
         unit_dump->Log(" %x", bw::player_waits[i]);
     }
     unit_dump->Log("\n");
-    unit_dump->Flush();
     old_sync = move(sync);
 }
 
-static uint32_t HashSprite(const Sprite *sprite)
-{
-    uint32_t hash = sprite->sprite_id << 16 | sprite->player << 8 | sprite->visibility_mask;
-    hash ^= sprite->elevation;
-    hash ^= sprite->width << 24;
-    hash ^= sprite->height << 16;
-    hash ^= sprite->position.x << 8;
-    hash ^= sprite->position.y;
-    return hash;
-}
-
 static void LogSync(const SyncHashes *hashes)
 {
     sync_log->Log("%08X %08X %08X %08X %08X %08X %08X %08X %08X %08X\n", hashes->main_hash, *bw::rng_seed,
@@ -97,6 +152,41 @@ static void LogSync(const SyncHashes *hashes)
     DumpUnits();
 }
 
+static void FinishHeadlessRun(const SyncHashes &hashes)
+{
+    double seconds = (double)(PerformanceCounter() - headless.start_tick) / headless.frequency;
+    uint32_t frames = *bw::frame_count - headless.start_frame;
+    double frames_per_second = seconds == 0.0 ? 0.0 : frames / seconds;
+    double avg_ms = frames == 0 ? 0.0 : (double)headless.total_object_time * 1000.0 / headless.frequency / frames;
+    double slowest_ms = (double)headless.slowest_frame * 1000.0 / headless.frequency;
+
+    char filename[260];
+    snprintf(filename, sizeof filename, "%s/headless.txt", log_path);
+    FILE *file = fopen(filename, "w");
+    if (file != nullptr)
+    {
+        fprintf(file, "Frames: %d (%d - %d)\n", frames, headless.start_frame, *bw::frame_count);
+        fprintf(file, "Time: %f s, %f frames per second\n", seconds, frames_per_second);
+        fprintf(file, "Frame time: average %f ms, slowest %f ms\n", avg_ms, slowest_ms);
+        fprintf(file, "Sync: %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X\n", hashes.main_hash,
+                *bw::rng_seed, hashes.units_hash, hashes.bullets_hash, hashes.unit_sprites_hash,
+                hashes.bullet_sprites_hash, hashes.paths_hash, hashes.ai_region_hash, hashes.ai_hash,
+                hashes.trigger_hash);
+        fclose(file);
+    }
+    perf_log->Log("Headless run: %d frames in %f s (%f fps), average %f ms, slowest %f ms\n",
+            frames, seconds, frames_per_second, avg_ms, slowest_ms);
+    perf_log->Flush();
+    debug_log->Log("Headless run finished at frame %d, %f fps\n", *bw::frame_count, frames_per_second);
+    debug_log->Flush();
+    if (headless.muted_sound)
+        bw::ToggleSound();
+    if (SyncTest)
+        sync_log->Flush();
+    sync_dump.reset();
+    ExitProcess(0);
+}
+
 static SyncHashes GetSyncHashes()
 {
     uint32_t units_hash = 0, bullets_hash = 0, paths_hash = 0, ai_region_hash = 0, ai_hash = 0;
@@ -120,11 +210,7 @@ static SyncHashes GetSyncHashes()
             {
                 paths_hash ^= unit->path->start.AsDword() | unit->path->next_pos.AsDword() | unit->path->end.AsDword();
                 paths_hash ^= unit->path->flags << 16;
-                unsigned int pos = 0;
-                for (int i = 0; i < unit->path->position_count && pos < sizeof unit->path->values; i++, pos += 2)
-                    paths_hash ^= unit->path->values[pos] | unit->path->values[pos + 1] << 8;
-                for (int i = 0; i < unit->path->unk1c && pos < sizeof unit->path->values; i++, pos += 1)
-                    paths_hash ^= unit->path->values[pos] << 16;
+                paths_hash ^= HashPathValues(unit);
                 paths_hash = (paths_hash << 1) | (paths_hash >> 31);
             }
             unit_sprites_hash ^= HashSprite(unit->sprite.get());
@@ -187,8 +273,12 @@ void ProgressObjects()
 {
     PerfClock clock;
     perf_log->Indent(2);
+    Iscript::frame_stats = Iscript::FrameStats();
+    combat_stats_counters.hits.store(0, std::memory_order_relaxed);
+    combat_stats_counters.misses.store(0, std::memory_order_relaxed);
 
     EnableRng(true);
+    StartObjectRngFrame();
     bw::TryUpdateCreepDisappear();
     ProgressAi();
 
@@ -222,6 +312,16 @@ void ProgressObjects()
     auto rest_time = clock.GetTime() - total_time;
     perf_log->Indent(-2);
     perf_log->Log("ProgressObjects: Pre %f ms + rest %f ms (+ units + bullets) = about %f ms\n", pre_time, rest_time, clock.GetTime());
+    if (PerfTest)
+    {
+        perf_log->Log("Iscript: %u images waiting, %u stepped\n",
+                Iscript::frame_stats.waiting_images, Iscript::frame_stats.stepped_images);
+        uint32_t hits = combat_stats_counters.hits.load(std::memory_order_relaxed);
+        uint32_t misses = combat_stats_counters.misses.load(std::memory_order_relaxed);
+        uint32_t total = hits + misses;
+        perf_log->Log("Combat stats: %u hits, %u misses (%u%% hit rate)\n",
+                hits, misses, total == 0 ? 0 : hits * 100 / total);
+    }
 }
 
 inline void SetFrameState(int state)
@@ -289,7 +389,9 @@ static bool ProgressFrame()
             break;
         }
 
-        if ((dont_pause_on_alttab && bw::game_speed_waits[*bw::game_speed] < 2) || IsMultiplayer() || *bw::window_active)
+        bool can_progress = (dont_pause_on_alttab && bw::game_speed_waits[*bw::game_speed] < 2) ||
+            IsMultiplayer() || *bw::window_active || headless_mode;
+        if (can_progress)
         {
             *bw::image_flags |= 0x2;
             if (IsPaused())
@@ -305,23 +407,35 @@ static bool ProgressFrame()
                     game_tests->NextFrame();
 
                 objects_progressed++;
+                uint64_t frame_start = headless_mode ? PerformanceCounter() : 0;
                 ProgressObjects();
 
                 auto hashes = GetSyncHashes();
                 *bw::sync_hash = hashes.main_hash >> (8 * (*bw::frame_count & 0x3));
                 if (SyncTest)
                     LogSync(&hashes);
+                if (headless_mode)
+                {
+                    uint64_t frame_time = PerformanceCounter() - frame_start;
+                    headless.total_object_time += frame_time;
+                    headless.slowest_frame = std::max(headless.slowest_frame, frame_time);
+                    if (headless.end_frame != 0 && *bw::frame_count >= headless.end_frame)
+                        FinishHeadlessRun(hashes);
+                }
             }
         }
         EnableRng(true);
         ProgressTriggers();
         EnableRng(false);
 
-        if (IsReplay())
+        if (IsReplay() && !headless_mode)
             bw::Replay_RefershUiIfNeeded();
 
-        *bw::next_frame_tick += bw::game_speed_waits[*bw::game_speed];
         uint32_t tick = GetTickCount();
+        if (headless_mode)
+            *bw::next_frame_tick = tick;
+        else
+            *bw::next_frame_tick += bw::game_speed_waits[*bw::game_speed];
         if (tick < *bw::next_frame_tick)
         {
             SetFrameState(5);
@@ -355,20 +469,25 @@ int ProgressFrames()
         last_tick = new_tick;
     }
 
+    if (headless_mode && !headless.started && IsInGame())
+        StartHeadlessRun();
+
+    unsigned int wait = headless_mode ? HeadlessReturnWait : render_wait;
     do
     {
         auto ret = ProgressFrame();
         if (!ret)
             break;
         fps_count++;
-    } while (IsInGame() && GetTickCount() - new_tick < render_wait && !force_render);
+    } while (IsInGame() && GetTickCount() - new_tick < wait && !force_render);
     force_render = false;
 
     // Bw has these rare cases when it should RefreshUi but doesn't
     // (Taking scv away from building that is being constructed).
     // But it calls RefreshUi at so many places the issue is rarely seen.
     // So just RefreshUi every frame, it was done almost every frame anyways.
-    RefreshUi();
+    if (!headless_mode)
+        RefreshUi();
     return objects_progressed;
 }
 
@@ -385,6 +504,8 @@ static void FreeAllObjects()
 void GameEnd()
 {
     FreeAllObjects();
+    headless.started = false;
+    sync_dump.reset();
     if (*bw::is_ingame2)
     {
         *bw::leave_game_tick = GetTickCount();
@@ -476,6 +597,7 @@ void GameEnd()
     if (IsReplay())
     {
         (*bw::replay_data)->unk4 = 0;
+        ClearReplayIndex();
         if (*bw::playback_commands)
         {
             storm::SMemFree(*bw::playback_commands, __FILE__, __LINE__, 0);
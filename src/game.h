@@ -13,6 +13,12 @@ void BriefingOk(Dialog *dlg, int leave);
 // Forces a render/ui update before next frame (if the render skip command was used)
 void ForceRender();
 
+/// Headless mode disables drawing, sounds and ui refreshes, and simulates frames as fast
+/// as possible. Once end_frame is reached, final sync hashes and frame rate are written
+/// to headless.txt in the log directory and the process exits. (end_frame 0 never exits)
+/// Can also be enabled by setting TEIPPI_HEADLESS environment variable to the end frame.
+void EnableHeadlessMode(uint32_t end_frame);
+
 struct DoWeaponDamageData
 {
     DoWeaponDamageData(Unit *a, int p, Unit *t, int d, int w, int dir) :
@@ -119,6 +125,7 @@ static_assert(sizeof(Got) == 0x20, "sizeof(Got)");
 extern float fps;
 extern unsigned int render_wait;
 extern bool all_visions;
+extern bool headless_mode;
 
 extern GameTests *game_tests;
 
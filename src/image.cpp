@@ -557,19 +557,15 @@ void Image::SetIscriptAnimation(Iscript::Context *ctx, int anim)
         if (iscript.animation != AirAttkRpt && iscript.animation != AirAttkInit)
             anim = AirAttkInit;
     }
-    uint8_t *pos = *bw::iscript + iscript.header;
-    if (*(int32_t *)(pos + 4) >= anim)
+    int anim_off = iscript.AnimationPos(ctx->iscript, anim);
+    if (anim_off != 0)
     {
-        int anim_off = *(uint16_t *)(pos + 8 + anim * sizeof(uint16_t));
-        if (anim_off != 0)
-        {
-            iscript.animation = anim;
-            iscript.pos = anim_off;
-            iscript.return_pos = 0;
-            iscript.wait = 0;
-            ProgressFrame(ctx);
-            return;
-        }
+        iscript.animation = anim;
+        iscript.pos = anim_off;
+        iscript.return_pos = 0;
+        iscript.wait = 0;
+        ProgressFrame(ctx);
+        return;
     }
     Warning("SetIscriptAnimation: Image %s does not have animation %s",
             DebugStr().c_str(), Iscript::Script::AnimationName(anim));
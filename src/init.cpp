@@ -10,6 +10,7 @@
 #include "ai.h"
 #include "bullet.h"
 #include "image.h"
+#include "iscript.h"
 #include "limits.h"
 #include "player.h"
 #include "replay.h"
@@ -226,6 +227,9 @@ int InitGame()
     bw::InitAi();
     bw::InitTerrain();
     bw::InitImages();
+    Iscript::compiled_iscript.Compile(*bw::iscript);
+    for (const auto &error : Iscript::compiled_iscript.Errors())
+        Warning("iscript.bin: %s", error.c_str());
     bw::InitSprites();
     InitCursorMarker();
     bw::InitFlingies();
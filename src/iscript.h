@@ -5,34 +5,10 @@
 #include "offsets.h"
 #include "constants/iscript.h"
 #include "common/iter.h"
+#include "iscript_decode.h"
 
 namespace Iscript {
 
-using OffsetSize = uint16_t;
-
-struct Command
-{
-    Command() : opcode(0xff), pos(0), val(0) {}
-    Command(uint8_t op) : opcode(op), pos(0), val(0) {}
-    int ParamsLength() const;
-    int Size() const { return 1 + ParamsLength(); }
-
-    std::string DebugStr() const;
-
-    int val1() const { return vals[0]; }
-    int val2() const { return vals[1]; }
-
-    uint8_t opcode;
-    OffsetSize pos;
-    union
-    {
-        int val;
-        int16_t vals[2];
-        const uint8_t *data;
-    };
-    Point point;
-};
-
 /// Used by the iscript command handlers to determine if the command was handled.
 enum class CmdResult
 {
@@ -99,9 +75,22 @@ class Script
         /// Returns false if header does not exist
         bool Initialize(const uint8_t *iscript, int iscript_header_id);
 
-    private:
-        Command Decode(const uint8_t *data) const;
+        /// Returns position of the animation in the current header, or 0 if it does not exist
+        OffsetSize AnimationPos(const uint8_t *iscript, int anim) const;
+};
+
+/// Compiled by InitGame
+extern CompiledScript compiled_iscript;
+
+/// How many images were progressed during the current frame, only counted with PerfTest.
+/// Waiting images only had their wait timer decremented, stepped ones ran their script.
+struct FrameStats
+{
+    constexpr FrameStats() : waiting_images(0), stepped_images(0) { }
+    uint32_t waiting_images;
+    uint32_t stepped_images;
 };
+extern FrameStats frame_stats;
 
 } // namespace iscript
 
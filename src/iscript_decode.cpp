@@ -0,0 +1,450 @@
+#include "iscript_decode.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+namespace Iscript {
+
+std::string Command::DebugStr() const
+{
+    using namespace Opcode;
+    switch (opcode)
+    {
+        case PlayFram:
+            return "playfram";
+        case PlayFramTile:
+            return "playframtile";
+        case SetHorPos:
+            return "sethorpos";
+        case SetVertPos:
+            return "setvertpos";
+        case SetPos:
+            return "setpos";
+        case Wait:
+            return "wait";
+        case WaitRand:
+            return "waitrand";
+        case Goto:
+            return "goto";
+        case ImgOl:
+            return "imgol";
+        case ImgUl:
+            return "imgul";
+        case ImgOlOrig:
+            return "imgolorig";
+        case SwitchUl:
+            return "switchul";
+        case UnusedC:
+            return "unusedc";
+        case ImgOlUseLo:
+            return "imgoluselo";
+        case ImgUlUseLo:
+            return "imguluselo";
+        case SprOl:
+            return "sprol";
+        case HighSprOl:
+            return "highsprol";
+        case LowSprUl:
+            return "lowsprul";
+        case UflUnstable:
+            return "uflunstable";
+        case SprUlUseLo:
+            return "spruluselo";
+        case SprUl:
+            return "sprul";
+        case SprOlUseLo:
+            return "sproluselo";
+        case End:
+            return "end";
+        case SetFlipState:
+            return "setflipstate";
+        case PlaySnd:
+            return "playsnd";
+        case PlaySndRand:
+            return "playsndrand";
+        case PlaySndBtwn:
+            return "playsndbtwn";
+        case DoMissileDmg:
+            return "domissiledmg";
+        case AttackMelee:
+            return "attackmelee";
+        case FollowMainGraphic:
+            return "followmaingraphic";
+        case RandCondJmp:
+            return "randcondjmp";
+        case TurnCcWise:
+            return "turnccwise";
+        case TurnCWise:
+            return "turncwise";
+        case Turn1CWise:
+            return "turn1cwise";
+        case TurnRand:
+            return "turnrand";
+        case SetSpawnFrame:
+            return "setspawnframe";
+        case SigOrder:
+            return "sigorder";
+        case AttackWith:
+            return "attackwith";
+        case Attack:
+            return "attack";
+        case CastSpell:
+            return "castspell";
+        case UseWeapon:
+            return "useweapon";
+        case Move:
+            return "move";
+        case GotoRepeatAttk:
+            return "gotorepeatattk";
+        case EngFrame:
+            return "engframe";
+        case EngSet:
+            return "engset";
+        case HideCursorMarker:
+            return "hidecursormarker";
+        case NoBrkCodeStart:
+            return "nobrkcodestart";
+        case NoBrkCodeEnd:
+            return "nobrkcodeend";
+        case IgnoreRest:
+            return "ignorerest";
+        case AttkShiftProj:
+            return "attkshiftproj";
+        case TmpRmGraphicStart:
+            return "tmprmgraphicstart";
+        case TmpRmGraphicEnd:
+            return "tmprmgraphicend";
+        case SetFlDirect:
+            return "setfldirect";
+        case Call:
+            return "call";
+        case Return:
+            return "return";
+        case SetFlSpeed:
+            return "setflspeed";
+        case CreateGasOverlays:
+            return "creategasoverlays";
+        case PwrupCondJmp:
+            return "pwrupcondjmp";
+        case TrgtRangeCondJmp:
+            return "trgtrangecondjmp";
+        case TrgtArcCondJmp:
+            return "trgtarccondjmp";
+        case CurDirectCondJmp:
+            return "curdirectcondjmp";
+        case ImgUlNextId:
+            return "imgulnextid";
+        case Unused3e:
+            return "unused3e";
+        case LiftoffCondJmp:
+            return "liftoffcondjmp";
+        case WarpOverlay:
+            return "warpoverlay";
+        case OrderDone:
+            return "orderdone";
+        case GrdSprOl:
+            return "grdsprol";
+        case Unused43:
+            return "unused43";
+        case DoGrdDamage:
+            return "dogrddamage";
+        default:
+        {
+            char buf[32];
+            snprintf(buf, sizeof buf, "Unknown (%x)", opcode);
+            return buf;
+        }
+    }
+}
+
+int Command::ParamsLength() const
+{
+    using namespace Opcode;
+    switch (opcode)
+    {
+        case PlayFram: case PlayFramTile: case SetPos: case WaitRand:
+        case Goto: case ImgOlOrig: case SwitchUl: case UflUnstable:
+        case SetFlSpeed: case PwrupCondJmp: case ImgUlNextId: case LiftoffCondJmp:
+        case PlaySnd: case Call: case WarpOverlay:
+            return 2;
+        case SetHorPos: case SetVertPos: case Wait: case SetFlipState:
+        case TurnCcWise: case TurnCWise: case TurnRand: case SetSpawnFrame:
+        case SigOrder: case AttackWith: case UseWeapon: case Move:
+        case AttkShiftProj: case SetFlDirect: case CreateGasOverlays: case OrderDone:
+        case EngFrame: case EngSet:
+            return 1;
+        case ImgOl: case ImgUl: case ImgUlUseLo: case ImgOlUseLo: case SprOl:
+        case SprUl: case LowSprUl: case HighSprOl: case SprUlUseLo:
+        case PlaySndBtwn: case TrgtRangeCondJmp: case GrdSprOl:
+            return 4;
+        case TrgtArcCondJmp: case CurDirectCondJmp:
+            return 6;
+        case UnusedC: case End: case DoMissileDmg: case FollowMainGraphic:
+        case Turn1CWise: case Attack: case CastSpell: case GotoRepeatAttk:
+        case HideCursorMarker: case NoBrkCodeStart: case NoBrkCodeEnd: case IgnoreRest:
+        case TmpRmGraphicStart: case TmpRmGraphicEnd: case Return: case Unused3e:
+        case Unused43: case DoGrdDamage:
+            return 0;
+        case RandCondJmp: case SprOlUseLo:
+            return 3;
+        case PlaySndRand: case AttackMelee:
+            return 1 + 2 * data[0];
+        default:
+            return 0;
+    }
+}
+
+Command Decode(const uint8_t *data)
+{
+    Command cmd(data[0]);
+    using namespace Opcode;
+    switch (cmd.opcode)
+    {
+        case WaitRand:
+            cmd.vals[0] = data[1];
+            cmd.vals[1] = data[2];
+        break;
+        case SetPos: case ImgUlNextId:
+            cmd.point.x = *(int8_t *)(data + 1);
+            cmd.point.y = *(int8_t *)(data + 2);
+        break;
+        case PlayFram: case PlayFramTile: case ImgOlOrig: case SwitchUl:
+        case UflUnstable: case PlaySnd: case SetFlSpeed: case WarpOverlay:
+            cmd.val = *(int16_t *)(data + 1);
+        break;
+        case EngFrame: case EngSet:
+            cmd.val = *(uint8_t *)(data + 1);
+        break;
+        case PwrupCondJmp:  case LiftoffCondJmp: case Call: case Goto:
+            cmd.pos = *(uint16_t *)(data + 1);
+        break;
+        case SetHorPos:
+            cmd.point = Common::Point16(*(int8_t *)(data + 1), 0);
+        break;
+        case SetVertPos:
+            cmd.point = Common::Point16(0, *(int8_t *)(data + 1));
+        break;
+        case Wait: case SetFlipState:
+        case TurnCcWise: case TurnCWise: case TurnRand: case SetSpawnFrame:
+        case SigOrder: case AttackWith: case UseWeapon: case Move:
+        case AttkShiftProj: case SetFlDirect: case OrderDone:
+            cmd.val = data[1];
+        break;
+        case CreateGasOverlays:
+            cmd.val = *(int8_t *)(data + 1);
+        break;
+        case ImgOl: case ImgUl: case ImgUlUseLo: case ImgOlUseLo: case SprOl:
+        case SprUl: case LowSprUl: case HighSprOl: case SprUlUseLo:
+        case SprOlUseLo: case GrdSprOl:
+            cmd.val = *(uint16_t *)(data + 1);
+            cmd.point.x = *(int8_t *)(data + 3);
+            cmd.point.y = *(int8_t *)(data + 4);
+        break;
+        case PlaySndBtwn:
+            cmd.vals[0] = *(uint16_t *)(data + 1);
+            cmd.vals[1] = *(uint16_t *)(data + 3);
+        break;
+        case TrgtRangeCondJmp:
+            cmd.val = *(uint16_t *)(data + 1);
+            cmd.pos = *(uint16_t *)(data + 3);
+        break;
+        case TrgtArcCondJmp: case CurDirectCondJmp:
+            cmd.vals[0] = *(uint16_t *)(data + 1);
+            cmd.vals[1] = *(uint16_t *)(data + 3);
+            cmd.pos = *(uint16_t *)(data + 5);
+        break;
+        case UnusedC: case End: case DoMissileDmg: case FollowMainGraphic:
+        case Turn1CWise: case Attack: case CastSpell: case GotoRepeatAttk:
+        case HideCursorMarker: case NoBrkCodeStart: case NoBrkCodeEnd: case IgnoreRest:
+        case TmpRmGraphicStart: case TmpRmGraphicEnd: case Return: case Unused3e:
+        case Unused43:
+        break;
+        case DoGrdDamage:
+            cmd.opcode = DoMissileDmg;
+        break;
+        case RandCondJmp:
+            cmd.val = data[1];
+            cmd.pos = *(uint16_t *)(data + 2);
+        break;
+        case PlaySndRand: case AttackMelee:
+            cmd.data = data + 1;
+        break;
+        default:
+        break;
+    }
+    return cmd;
+}
+
+/// Animation count of a script header, by its type
+static int AnimationCount(int header_type)
+{
+    switch (header_type)
+    {
+        case 0: case 1:
+            return 2;
+        case 2:
+            return 4;
+        case 12: case 13:
+            return 14;
+        case 14: case 15:
+            return 16;
+        case 20: case 21:
+            return 22;
+        case 23:
+            return 24;
+        case 24:
+            return 26;
+        case 26: case 27: case 28: case 29:
+            return 28;
+        default:
+            return 0;
+    }
+}
+
+void CompiledScript::Clear()
+{
+    iscript = nullptr;
+    entries.clear();
+    positions.clear();
+    headers.clear();
+    header_ids.clear();
+    header_positions.clear();
+    errors.clear();
+}
+
+template <class... Args>
+static std::string Format(const char *format, Args... args)
+{
+    char buf[256];
+    snprintf(buf, sizeof buf, format, args...);
+    return buf;
+}
+
+void CompiledScript::CompileHeader(int header_id, OffsetSize pos)
+{
+    if (header_id < (int)header_ids.size() && header_ids[header_id] != NoHeader)
+    {
+        // Script::Initialize used the first one
+        errors.emplace_back(Format("Header %x is defined multiple times", header_id));
+        return;
+    }
+    Header header;
+    header.pos = pos;
+    header.animation_count = 0;
+    // Bw accepts animations up to the 32-bit value following the magic,
+    // which is the header type followed by padding
+    const uint8_t *data = iscript + pos;
+    int32_t max_anim = *(const int32_t *)(data + 4);
+    int anim_count = AnimationCount(data[4]);
+    if (anim_count == 0)
+    {
+        errors.emplace_back(Format("Header %x has unknown type %x", header_id, data[4]));
+        anim_count = MaxAnimations;
+    }
+    anim_count = std::min(anim_count, (int)std::min(max_anim + 1, (int32_t)MaxAnimations));
+    if (pos + 8 + anim_count * sizeof(OffsetSize) > 0x10000)
+    {
+        errors.emplace_back(Format("Header %x at %x is out of bounds", header_id, pos));
+        anim_count = 0;
+    }
+    for (int i = 0; i < anim_count; i++)
+    {
+        OffsetSize anim_pos = *(const OffsetSize *)(data + 8 + i * sizeof(OffsetSize));
+        if (anim_pos != 0 && iscript[anim_pos] > Opcode::DoGrdDamage)
+        {
+            errors.emplace_back(Format("Header %x animation %x points to an invalid command at %x",
+                        header_id, i, anim_pos));
+            anim_pos = 0;
+        }
+        header.animations[i] = anim_pos;
+        if (anim_pos != 0)
+            header.animation_count = i + 1;
+    }
+    for (int i = header.animation_count; i < MaxAnimations; i++)
+        header.animations[i] = 0;
+
+    if (header_id >= (int)header_ids.size())
+        header_ids.resize(header_id + 1, uint16_t(NoHeader));
+    header_ids[header_id] = headers.size();
+    if (header_positions[pos] == NoHeader)
+        header_positions[pos] = headers.size();
+    headers.emplace_back(header);
+}
+
+void CompiledScript::CompileHeaders()
+{
+    header_positions.resize(0x10000, uint16_t(NoHeader));
+    uint32_t header_offset = *(const uint32_t *)iscript;
+    const OffsetSize *table = (const OffsetSize *)(iscript + header_offset);
+    for (; table[0] != 0xffff; table += 2)
+    {
+        if (headers.size() == NoHeader)
+        {
+            errors.emplace_back("Too many headers");
+            break;
+        }
+        CompileHeader(table[0], table[1]);
+    }
+}
+
+void CompiledScript::Compile(const uint8_t *iscript_)
+{
+    using namespace Opcode;
+    Clear();
+    if (iscript_ == nullptr)
+        return;
+    iscript = iscript_;
+    positions.resize(0x10000, uint32_t(NoEntry));
+    CompileHeaders();
+
+    std::vector<OffsetSize> unvisited;
+    for (const Header &header : headers)
+    {
+        for (int i = 0; i < header.animation_count; i++)
+        {
+            if (header.animations[i] != 0)
+                unvisited.emplace_back(header.animations[i]);
+        }
+    }
+    while (!unvisited.empty())
+    {
+        uint32_t pos = unvisited.back();
+        unvisited.pop_back();
+        // Decodes until the script jumps away, as then the commands get stored mostly in
+        // the order they will be executed
+        while (positions[pos] == NoEntry)
+        {
+            const uint8_t *data = iscript + pos;
+            if (data[0] > DoGrdDamage)
+                break;
+            Entry entry;
+            entry.cmd = Decode(data);
+            uint32_t next = pos + entry.cmd.Size();
+            if (next > 0xffff)
+                break;
+            entry.next = next;
+            positions[pos] = entries.size();
+            entries.emplace_back(entry);
+
+            bool falls_through = true;
+            switch (entry.cmd.opcode)
+            {
+                case Goto:
+                    falls_through = false;
+                    // Fall through
+                case Call: case RandCondJmp: case PwrupCondJmp: case LiftoffCondJmp:
+                case TrgtRangeCondJmp: case TrgtArcCondJmp: case CurDirectCondJmp:
+                    unvisited.emplace_back(entry.cmd.pos);
+                break;
+                case End: case Return:
+                    falls_through = false;
+                break;
+            }
+            if (!falls_through)
+                break;
+            pos = next;
+        }
+    }
+}
+
+} // namespace Iscript
@@ -0,0 +1,128 @@
+#ifndef ISCRIPT_DECODE_H
+#define ISCRIPT_DECODE_H
+
+#include <stdint.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "console/types.h"
+#include "constants/iscript.h"
+
+// Kept free of game headers, as it is also used by tools/iscriptbench.cpp
+
+namespace Iscript {
+
+using OffsetSize = uint16_t;
+
+struct Command
+{
+    Command() : opcode(0xff), pos(0), val(0) {}
+    Command(uint8_t op) : opcode(op), pos(0), val(0) {}
+    int ParamsLength() const;
+    int Size() const { return 1 + ParamsLength(); }
+
+    std::string DebugStr() const;
+
+    int val1() const { return vals[0]; }
+    int val2() const { return vals[1]; }
+
+    uint8_t opcode;
+    OffsetSize pos;
+    union
+    {
+        int val;
+        int16_t vals[2];
+        const uint8_t *data;
+    };
+    Common::Point16 point;
+};
+
+/// Decodes the command at data
+Command Decode(const uint8_t *data);
+
+/// Every command of iscript.bin that can be reached from the script headers, decoded once
+/// when the game is initialized, so that Script::ProgressFrame can just look them up.
+/// Positions which were not reached (only possible with unusual scripts) have to be decoded
+/// by the caller.
+/// Also contains the header table, indexed both by header id and position, so that
+/// creating images and switching animations don't have to scan iscript.bin.
+class CompiledScript
+{
+    public:
+        struct Entry
+        {
+            Command cmd;
+            /// Position of the following command
+            OffsetSize next;
+        };
+
+        CompiledScript() : iscript(nullptr) {}
+
+        void Compile(const uint8_t *iscript);
+        void Clear();
+
+        bool IsCompiledFor(const uint8_t *script) const { return script == iscript && script != nullptr; }
+        uint32_t CommandCount() const { return entries.size(); }
+        uint32_t HeaderCount() const { return headers.size(); }
+        /// Problems found while compiling, such as animations pointing to invalid commands.
+        /// Those animations are treated as if the header didn't have them.
+        const std::vector<std::string> &Errors() const { return errors; }
+
+        /// Returns false if the header does not exist
+        bool FindHeader(int header_id, OffsetSize *out_pos) const
+        {
+            if (header_id < 0 || header_id >= (int)header_ids.size() || header_ids[header_id] == NoHeader)
+                return false;
+            *out_pos = headers[header_ids[header_id]].pos;
+            return true;
+        }
+
+        /// Returns 0 if the header at header_pos does not have the animation
+        OffsetSize AnimationPos(OffsetSize header_pos, int anim) const
+        {
+            uint16_t index = header_positions[header_pos];
+            if (index == NoHeader || anim < 0 || anim >= headers[index].animation_count)
+                return 0;
+            return headers[index].animations[anim];
+        }
+
+        /// Returns nullptr if the position was not decoded.
+        const Entry *Find(OffsetSize pos) const
+        {
+            uint32_t index = positions[pos];
+            if (index == NoEntry)
+                return nullptr;
+            return &entries[index];
+        }
+
+    private:
+        static const uint32_t NoEntry = 0xffffffff;
+        static const uint16_t NoHeader = 0xffff;
+        static const int MaxAnimations = 0x1c;
+
+        struct Header
+        {
+            OffsetSize pos;
+            uint8_t animation_count;
+            OffsetSize animations[MaxAnimations];
+        };
+
+        void CompileHeaders();
+        void CompileHeader(int header_id, OffsetSize pos);
+
+        const uint8_t *iscript;
+        std::vector<Entry> entries;
+        /// Index to entries for each position
+        std::vector<uint32_t> positions;
+        std::vector<Header> headers;
+        /// Index to headers for each header id
+        std::vector<uint16_t> header_ids;
+        /// Index to headers for each position
+        std::vector<uint16_t> header_positions;
+        std::vector<std::string> errors;
+};
+
+} // namespace Iscript
+
+#endif /* ISCRIPT_DECODE_H */
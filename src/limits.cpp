@@ -251,7 +251,7 @@ static void ProgressIscriptFrame_Hook(Image *image, Iscript::Script *script, int
     if (test_run)
     {
         Assert(out_speed != nullptr);
-        MovementIscriptContext ctx(*bw::active_iscript_unit, out_speed, MainRng());
+        MovementIscriptContext ctx(*bw::active_iscript_unit, out_speed, (*bw::active_iscript_unit)->IscriptRng());
         script->ProgressFrame(&ctx, image);
     }
     else
@@ -527,7 +527,10 @@ void RemoveLimits(Common::PatchContext *patch)
     });
 
     // Won't be called when loading save though.
-    patch->CallHook(bw::PathingInited, [] { unit_search->Init(); });
+    patch->CallHook(bw::PathingInited, [] {
+        unit_search->Init();
+        InitRegionPaths();
+    });
 
     patch->Hook(bw::ProgressUnstackMovement, &Unit::ProgressUnstackMovement);
 
@@ -544,6 +547,7 @@ void RemoveLimits(Common::PatchContext *patch)
     patch->Hook(bw::TriggerPortraitFinished, TriggerPortraitFinished_Hook);
     bw::trigger_actions[0x7] = TrigAction_Transmission;
     bw::trigger_actions[0xa] = TrigAction_CenterView;
+    HookTriggerActions();
 
     patch->Hook(bw::ChangeMovementTargetToUnit, [](Unit *unit, Unit *target) -> int {
         return unit->ChangeMovementTargetToUnit(target);
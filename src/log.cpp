@@ -8,6 +8,12 @@
 #include "console/windows_wrap.h"
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "offsets.h"
 
@@ -19,17 +25,246 @@ SyncLog *sync_log;
 DebugLog_Actual *unit_dump;
 DebugLog_Actual *error_log;
 
-DebugLog_Actual::DebugLog_Actual(const char *f) : filename(f)
+/// Ring buffer of one logging thread. Only that thread pushes records, and only the
+/// writer thread of LogSink reads them.
+class LogRing
+{
+    public:
+        static const uint32_t Size = 0x40000;
+        /// Longer texts have to be pushed in several records
+        static const uint32_t MaxText = Size / 4;
+        struct Header
+        {
+            /// nullptr if the rest of the buffer is skipped
+            DebugLog_Actual *log;
+            uint32_t frame;
+            int32_t indent;
+            uint32_t length;
+        };
+
+        LogRing() : buffer(Size), head(0), tail(0) {}
+
+        /// Returns false if there is no space
+        bool Push(DebugLog_Actual *log, uint32_t frame, int indent, const char *text, uint32_t length)
+        {
+            uint32_t needed = RecordSize(length);
+            uint32_t pos = head.load(std::memory_order_relaxed);
+            uint32_t read_pos = tail.load(std::memory_order_acquire);
+            uint32_t to_end = Size - pos % Size;
+            uint32_t skip = to_end < needed ? to_end : 0;
+            if (pos + skip + needed - read_pos > Size)
+                return false;
+            if (skip >= sizeof(Header))
+            {
+                Header padding = { nullptr, 0, 0, 0 };
+                memcpy(buffer.data() + pos % Size, &padding, sizeof padding);
+            }
+            pos += skip;
+            Header header = { log, frame, indent, length };
+            memcpy(buffer.data() + pos % Size, &header, sizeof header);
+            memcpy(buffer.data() + pos % Size + sizeof header, text, length);
+            head.store(pos + needed, std::memory_order_release);
+            return true;
+        }
+
+        /// Calls func(header, text) for every record pushed so far
+        template <class Func>
+        void Drain(Func func)
+        {
+            uint32_t pos = tail.load(std::memory_order_relaxed);
+            uint32_t end = head.load(std::memory_order_acquire);
+            while (pos != end)
+            {
+                uint32_t to_end = Size - pos % Size;
+                Header header;
+                if (to_end >= sizeof header)
+                    memcpy(&header, buffer.data() + pos % Size, sizeof header);
+                if (to_end < sizeof header || header.log == nullptr)
+                {
+                    pos += to_end;
+                    continue;
+                }
+                func(header, (const char *)buffer.data() + pos % Size + sizeof header);
+                pos += RecordSize(header.length);
+            }
+            tail.store(pos, std::memory_order_release);
+        }
+
+    private:
+        static uint32_t RecordSize(uint32_t length) { return (sizeof(Header) + length + 7) & ~7; }
+
+        std::vector<uint8_t> buffer;
+        /// Positions keep increasing and wrap at 2^32, which Size divides
+        std::atomic<uint32_t> head;
+        std::atomic<uint32_t> tail;
+};
+
+/// Writes the records of async logs. Never deleted, as the logs aren't either.
+class LogSink
+{
+    public:
+        LogSink() : flush_request(0), flush_done(0)
+        {
+            thread = std::thread(&LogSink::ThreadMain, this);
+        }
+
+        bool Push(DebugLog_Actual *log, uint32_t frame, int indent, const char *text, uint32_t length)
+        {
+            return ThreadRing()->Push(log, frame, indent, text, length);
+        }
+
+        void AddLog(DebugLog_Actual *log)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            logs.emplace_back(log);
+        }
+
+        void RemoveLog(DebugLog_Actual *log)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            logs.erase(std::remove(logs.begin(), logs.end(), log), logs.end());
+        }
+
+        void Flush()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            uint32_t request = ++flush_request;
+            cv.notify_one();
+            flushed_cv.wait(lock, [this, request] { return (int32_t)(flush_done - request) >= 0; });
+        }
+
+        /// Flush() for crash handlers, which may have interrupted a thread holding the mutex,
+        /// or be running on the writer thread itself. Returns false if timed out.
+        bool TryFlush(std::chrono::milliseconds timeout)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+            while (!lock.try_lock())
+            {
+                if (std::chrono::steady_clock::now() >= deadline)
+                    return false;
+                std::this_thread::yield();
+            }
+            uint32_t request = ++flush_request;
+            cv.notify_one();
+            return flushed_cv.wait_until(lock, deadline, [this, request] {
+                return (int32_t)(flush_done - request) >= 0;
+            });
+        }
+
+    private:
+        /// How often the rings get drained if nobody is waiting for a flush
+        static const int DrainIntervalMs = 20;
+
+        LogRing *ThreadRing()
+        {
+            static thread_local LogRing *ring = nullptr;
+            if (ring == nullptr)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                rings.emplace_back(new LogRing);
+                ring = rings.back().get();
+            }
+            return ring;
+        }
+
+        void ThreadMain()
+        {
+            std::vector<LogRing *> current_rings;
+            std::vector<DebugLog_Actual *> current_logs;
+            // Logs that have been written to without fflush
+            std::vector<DebugLog_Actual *> unflushed;
+            while (true)
+            {
+                uint32_t request;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait_for(lock, std::chrono::milliseconds(DrainIntervalMs), [this] {
+                        return flush_request != flush_done;
+                    });
+                    request = flush_request;
+                    current_rings.clear();
+                    for (const auto &ring : rings)
+                        current_rings.emplace_back(ring.get());
+                    current_logs = logs;
+                }
+                for (LogRing *ring : current_rings)
+                {
+                    ring->Drain([&](const LogRing::Header &header, const char *text) {
+                        DebugLog_Actual *log = header.log;
+                        if (!log->OpenFile())
+                            return;
+                        log->WritePrefix(header.frame, header.indent);
+                        fwrite(text, 1, header.length, log->log_file);
+                        if (std::find(unflushed.begin(), unflushed.end(), log) == unflushed.end())
+                            unflushed.emplace_back(log);
+                    });
+                }
+                // Records dropped before this pass are either written above or lost for good
+                for (DebugLog_Actual *log : current_logs)
+                {
+                    uint32_t dropped = log->dropped_records.exchange(0, std::memory_order_relaxed);
+                    if (dropped == 0 || !log->OpenFile())
+                        continue;
+                    fprintf(log->log_file, "--- %u log records dropped\n", dropped);
+                    if (std::find(unflushed.begin(), unflushed.end(), log) == unflushed.end())
+                        unflushed.emplace_back(log);
+                }
+                bool flush_all = request != flush_done;
+                auto it = std::remove_if(unflushed.begin(), unflushed.end(), [flush_all](DebugLog_Actual *log) {
+                    if (!flush_all && !log->auto_flush)
+                        return false;
+                    fflush(log->log_file);
+                    return true;
+                });
+                unflushed.erase(it, unflushed.end());
+                if (flush_all)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        flush_done = request;
+                    }
+                    flushed_cv.notify_all();
+                }
+            }
+        }
+
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::condition_variable flushed_cv;
+        std::vector<std::unique_ptr<LogRing>> rings;
+        std::vector<DebugLog_Actual *> logs;
+        uint32_t flush_request;
+        uint32_t flush_done;
+};
+
+static LogSink *log_sink;
+
+DebugLog_Actual::DebugLog_Actual(const char *f, LogMode mode) : filename(f), async(mode != LogMode::Direct),
+    lossless(mode == LogMode::AsyncLossless)
 {
     lock.clear();
     log_file = nullptr;
     indent = 0;
     prev_frame = 0xffffffff;
     auto_flush = true;
+    dropped_records = 0;
+    // Logs are only created by the main thread
+    if (async && log_sink == nullptr)
+        log_sink = new LogSink;
+    if (async)
+        log_sink->AddLog(this);
 }
 
 DebugLog_Actual::~DebugLog_Actual()
 {
+    // The sink may not have anything of this log left once it is deleted
+    if (async)
+    {
+        log_sink->Flush();
+        log_sink->RemoveLog(this);
+    }
     if (log_file != nullptr)
         fclose(log_file);
 }
@@ -41,8 +276,7 @@ DebugLog_Actual::Unlock DebugLog_Actual::Lock()
     return Unlock(this);
 }
 
-/// Path's last component is assumed to be a filename, not a directory name
-static void CreateDirTree(const std::string &path)
+void CreateDirTree(const std::string &path)
 {
     auto last_separator = path.find_last_of("/\\");
     if (last_separator == path.npos)
@@ -60,28 +294,29 @@ static void CreateDirTree(const std::string &path)
     }
 }
 
-void DebugLog_Actual::Log(const char *format, ...)
+bool DebugLog_Actual::OpenFile()
 {
-    auto unlock = Lock();
+    if (log_file != nullptr)
+        return true;
+    CreateDirTree(filename);
+    log_file = fopen(filename.c_str(), "w");
     if (log_file == nullptr)
-    {
-        CreateDirTree(filename);
-        log_file = fopen(filename.c_str(), "w");
-        if (log_file == nullptr)
-            return;
+        return false;
 
-        char timestamp[256];
-        time_t time_ = time(0);
-        struct tm *time = localtime(&time_);
-        strftime(timestamp, 256, "Log started on %Y-%m-%d %H:%M:%S\n", time);
-        fputs(timestamp, log_file);
-    }
+    char timestamp[256];
+    time_t time_ = time(0);
+    struct tm *time = localtime(&time_);
+    strftime(timestamp, 256, "Log started on %Y-%m-%d %H:%M:%S\n", time);
+    fputs(timestamp, log_file);
+    return true;
+}
 
-    uint32_t current_frame = *bw::frame_count;
-    if (current_frame != prev_frame)
+void DebugLog_Actual::WritePrefix(uint32_t frame, int indent)
+{
+    if (frame != prev_frame)
     {
-        fprintf(log_file, "--- Frame %d\n", *bw::frame_count);
-        prev_frame = current_frame;
+        fprintf(log_file, "--- Frame %d\n", frame);
+        prev_frame = frame;
     }
 
     if (indent)
@@ -96,22 +331,95 @@ void DebugLog_Actual::Log(const char *format, ...)
                 fwrite(spaces, 1, indent - i, log_file);
         }
     }
+}
 
+void DebugLog_Actual::Log(const char *format, ...)
+{
     va_list varg;
     va_start(varg, format);
+    if (async)
+    {
+        // Most lines fit in the stack buffer
+        char buf[512];
+        std::string long_buf;
+        va_list copy;
+        va_copy(copy, varg);
+        int length = vsnprintf(buf, sizeof buf, format, varg);
+        const char *text = buf;
+        if (length >= (int)sizeof buf)
+        {
+            long_buf.resize(length + 1);
+            vsnprintf(&long_buf[0], length + 1, format, copy);
+            text = long_buf.data();
+        }
+        va_end(copy);
+        va_end(varg);
+        if (length < 0)
+            return;
+        Push(text, length);
+        return;
+    }
+
+    auto unlock = Lock();
+    if (!OpenFile())
+    {
+        va_end(varg);
+        return;
+    }
+    WritePrefix(*bw::frame_count, indent);
     vfprintf(log_file, format, varg);
     va_end(varg);
 
     if (auto_flush)
-        Flush();
+        fflush(log_file);
+}
+
+void DebugLog_Actual::Push(const char *text, uint32_t length)
+{
+    uint32_t frame = *bw::frame_count;
+    int indent_ = indent.load(std::memory_order_relaxed);
+    // Long texts are split, the later parts have no indentation and the frame stays same,
+    // so the writer doesn't add anything between them
+    do
+    {
+        uint32_t part = std::min(length, LogRing::MaxText);
+        while (!log_sink->Push(this, frame, indent_, text, part))
+        {
+            if (!lossless)
+            {
+                dropped_records.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            log_sink->Flush();
+        }
+        text += part;
+        length -= part;
+        indent_ = 0;
+    } while (length != 0);
+}
+
+void DebugLog_Actual::Flush()
+{
+    if (async)
+        log_sink->Flush();
+    else if (log_file != nullptr)
+        fflush(log_file);
+}
+
+bool FlushAsyncLogs(int timeout_ms)
+{
+    if (log_sink == nullptr)
+        return true;
+    return log_sink->TryFlush(std::chrono::milliseconds(timeout_ms));
 }
 
 void DebugLog_Actual::Indent(int diff)
 {
-    auto unlock = Lock();
-    indent += diff;
-    if (indent < 0)
-        indent = 0;
+    int old = indent.load(std::memory_order_relaxed), value;
+    do
+    {
+        value = std::max(old + diff, 0);
+    } while (!indent.compare_exchange_weak(old, value, std::memory_order_relaxed));
 }
 
 void InitLogs()
@@ -126,13 +434,13 @@ void InitLogs()
 
     char buf[260];
     snprintf(buf, sizeof buf, "%s/teippi.txt", log_path);
-    debug_log = new DebugLog(buf);
+    debug_log = new DebugLog(buf, LogMode::Async);
     snprintf(buf, sizeof buf, "%s/error.txt", log_path);
     error_log = new DebugLog_Actual(buf);
     if (PerfTest)
     {
         snprintf(buf, sizeof buf, "%s/performance.txt", log_path);
-        perf_log = new PerfLog(buf);
+        perf_log = new PerfLog(buf, LogMode::Async);
     }
     // Remove old sync logs
     for (int i = 0; ; i++)
@@ -147,7 +455,7 @@ void InitLogs()
     if (SyncTest)
     {
         snprintf(buf, sizeof buf, "%s/sync.txt", log_path);
-        sync_log = new SyncLog(buf);
+        sync_log = new SyncLog(buf, LogMode::AsyncLossless);
         snprintf(buf, sizeof buf, "%s/dump", log_path);
         unit_dump = nullptr;
     }
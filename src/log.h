@@ -6,25 +6,53 @@
 #include <atomic>
 #include <string>
 
+/// How DebugLog_Actual writes the records
+enum class LogMode
+{
+    /// Log() writes to the file itself
+    Direct,
+    /// Log() only formats the text into a ring buffer of the calling thread, without
+    /// locking, and a background thread writes it to the file. Records of a single thread
+    /// stay in order, but records from different threads may get reordered.
+    /// If a thread's buffer is full, the record gets dropped, and the amount of dropped
+    /// records is written to the log after the background thread has emptied the buffers.
+    Async,
+    /// Like Async, but Log() waits for the background thread instead of dropping records.
+    /// For logs which get compared between players, where a missing line would look like
+    /// a desync.
+    AsyncLossless,
+};
+
 class DebugLog_Actual
 {
     public:
-        DebugLog_Actual(const char *);
+        DebugLog_Actual(const char *filename, LogMode mode = LogMode::Direct);
         ~DebugLog_Actual();
         void Log(const char *format, ...);
         void Indent(int diff);
         void AutoFlush(bool new_state) { auto_flush = new_state; }
-        void Flush() { fflush(log_file); }
+        /// With async logs, waits until everything logged so far by any thread has been written
+        void Flush();
 
     private:
+        bool OpenFile();
+        /// Writes the frame separator if the frame has changed, and the indentation
+        void WritePrefix(uint32_t frame, int indent);
+
         FILE *log_file;
-        int indent;
+        std::atomic<int> indent;
         uint32_t prev_frame;
         std::atomic_flag lock;
         std::string filename;
 
+        void Push(const char *text, uint32_t length);
+
         bool auto_flush;
+        const bool async;
+        const bool lossless;
+        std::atomic<uint32_t> dropped_records;
 
+        friend class LogSink;
         friend class Unlock;
         class Unlock
         {
@@ -37,11 +65,10 @@ class DebugLog_Actual
         Unlock Lock();
 };
 
-
 class DebugLog_Empty
 {
     public:
-        DebugLog_Empty(const char *) {}
+        DebugLog_Empty(const char *, LogMode mode = LogMode::Direct) {}
         ~DebugLog_Empty() {}
         void Log(const char *format, ...) {}
         void Indent(int diff) {}
@@ -50,6 +77,9 @@ class DebugLog_Empty
 };
 
 void InitLogs();
+/// Writes everything logged to async logs so far before the process dies, waiting at most
+/// timeout_ms. Returns false if the logs could not be written in time.
+bool FlushAsyncLogs(int timeout_ms);
 
 #ifdef DEBUG
 typedef DebugLog_Actual DebugLog;
@@ -75,6 +105,10 @@ extern SyncLog *sync_log;
 extern DebugLog_Actual *unit_dump;
 extern char log_path[260];
 
+/// Creates the directories of a file path.
+/// Path's last component is assumed to be a filename, not a directory name
+void CreateDirTree(const std::string &path);
+
 
 #endif // LOG_H
 
@@ -1,5 +1,6 @@
 #include "mainpatch.h"
 
+#include <stdlib.h>
 #include <time.h>
 #include "console/windows_wrap.h"
 #include "common/log_freeze.h"
@@ -29,6 +30,8 @@
 #include "yms.h"
 #include "unit_cache.h"
 #include "perfclock.h"
+#include "game.h"
+#include "pathing.h"
 
 namespace bw
 {
@@ -93,6 +96,8 @@ static LONG WINAPI ExceptionFilter(EXCEPTION_POINTERS *info)
     if (previous_exception_filter)
         result = previous_exception_filter(info);
 
+    // The lines right before the crash are likely still waiting for the log thread
+    FlushAsyncLogs(1000);
     SavePanickedReplay();
     // Terminate on debug because why not - release crashes properly so people won't get confused
     if (Debug && result != EXCEPTION_CONTINUE_EXECUTION)
@@ -199,6 +204,19 @@ void InitialPatch()
     InitPerfClockFrequency();
     InitFreezeLogging();
 
+    const char *headless_env = getenv("TEIPPI_HEADLESS");
+    if (headless_env != nullptr)
+        EnableHeadlessMode(strtoul(headless_env, nullptr, 0));
+    const char *object_rng_env = getenv("TEIPPI_OBJECT_RNG");
+    if (object_rng_env != nullptr)
+        object_rng_streams = strtoul(object_rng_env, nullptr, 0) != 0;
+    const char *region_paths_env = getenv("TEIPPI_REGION_PATHS");
+    if (region_paths_env != nullptr)
+        region_path_movement = strtoul(region_paths_env, nullptr, 0) != 0;
+    const char *flyer_batch_env = getenv("TEIPPI_FLYER_BATCH");
+    if (flyer_batch_env != nullptr)
+        batch_flyer_movement = strtoul(flyer_batch_env, nullptr, 0) != 0;
+
     threads = new ThreadPool<ScThreadVars>;
     threads->Init(sysinfo.dwNumberOfProcessors * 2);
     int thread_count = threads->GetThreadCount();
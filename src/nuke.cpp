@@ -48,7 +48,8 @@ void Unit::Order_NukeTrack()
         bw::DoNextQueuedOrderIfAble(this);
         SetButtons(unit_id);
         SetIscriptAnimation(Iscript::Animation::Idle, true, "Order_NukeTrack state 6", nullptr);
-        ghost.nukedot->SetIscriptAnimation_Lone(Iscript::Animation::Death, true, MainRng(), "Unit::Order_NukeTrack");
+        ghost.nukedot->SetIscriptAnimation_Lone(Iscript::Animation::Death, true, ghost.nukedot->IscriptRng(),
+                "Unit::Order_NukeTrack");
         ghost.nukedot = nullptr;
         bw::Ai_ReturnToNearestBaseForced(this);
     }
@@ -2,12 +2,15 @@
 
 #include "offsets.h"
 #include "console/assert.h"
+#include "perfclock.h"
+#include "region_path.h"
 #include "resolution.h"
 #include "dialog.h"
 #include "yms.h"
 #include "unit.h"
 #include "sprite.h"
 
+#include <algorithm>
 #include <unordered_set>
 
 #ifdef CONSOLE
@@ -18,12 +21,50 @@
 bool draw_region_borders = false;
 bool draw_region_data = false;
 bool draw_paths = false;
+bool region_path_movement = false;
 
 Pathing::PathingSystem *GetPathingSystem()
 {
     return *bw::pathing;
 }
 
+static Pathing::RegionGraph region_graph;
+static Pathing::RegionPathfinder region_pathfinder;
+static Pathing::RegionPathCache region_path_cache;
+
+void InitRegionPaths()
+{
+    using namespace Pathing;
+    PathingSystem *pathing = *bw::pathing;
+    region_graph.Clear();
+    region_path_cache.Clear();
+    for (int i = 0; i < pathing->region_count; i++)
+    {
+        const Region *region = &pathing->regions[i];
+        // The neighbours of same group come first
+        region_graph.AddRegion(region->x >> 8, region->y >> 8, region->group, region->neighbour_ids,
+                region->group_neighbour_count);
+    }
+}
+
+namespace Pathing {
+const std::vector<uint16_t> *FindRegionPath(int start_region, int goal_region)
+{
+    STATIC_PERF_CLOCK(FindRegionPath);
+    return region_path_cache.FindPath(region_graph, &region_pathfinder, start_region, goal_region, *bw::frame_count);
+}
+}
+
+bool DumpPathingData(const char *filename)
+{
+    FILE *file = fopen(filename, "wb");
+    if (file == nullptr)
+        return false;
+    region_graph.Write(file);
+    fclose(file);
+    return true;
+}
+
 int GetRegion(const Point &pos)
 {
     using namespace Pathing;
@@ -52,13 +93,27 @@ void *Path::operator new(size_t size)
 }
 #endif
 
+/// Paths are only created and deleted in the main thread
+static std::unordered_set<Path *> allocated_paths;
+
 Path::Path()
 {
     dodge_unit = nullptr;
+    allocated_paths.insert(this);
 }
 
 Path::~Path()
 {
+    allocated_paths.erase(this);
+}
+
+void ClearDodgeReferences(const Unit *unit)
+{
+    for (Path *path : allocated_paths)
+    {
+        if (path->dodge_unit == unit)
+            path->dodge_unit = nullptr;
+    }
 }
 
 Path *AllocatePath(uint16_t *region_count, uint16_t *position_count)
@@ -105,6 +160,48 @@ void CreateSimplePath(Unit *unit, const Point &next_pos, const Point &end)
     unit->path->values[2] = GetRegion(next_pos);
 }
 
+bool CreateRegionPath(Unit *unit, const Point &end)
+{
+    const auto *regions = Pathing::FindRegionPath(GetRegion(unit->sprite->position), GetRegion(end));
+    if (regions == nullptr)
+        return false;
+    // Waypoints are the centers of the regions between start and end, followed by end itself
+    uint16_t position_count = regions->size() - 1;
+    uint16_t region_count = regions->size();
+    if (position_count == 0)
+        position_count = 1;
+    Path *path = AllocatePath(&region_count, &position_count);
+    if (path == nullptr)
+        return false;
+    unit->path.reset(path);
+    const Pathing::PathingSystem *pathing = *bw::pathing;
+    for (int i = 0; i < position_count; i++)
+    {
+        Point pos = end;
+        if (i + 1 < (int)regions->size() - 1)
+        {
+            const Pathing::Region *region = &pathing->regions[(*regions)[i + 1]];
+            pos = Point(region->x >> 8, region->y >> 8);
+        }
+        path->values[i * 2] = pos.x;
+        path->values[i * 2 + 1] = pos.y;
+    }
+    for (int i = 0; i < region_count; i++)
+        path->values[position_count * 2 + i] = (*regions)[i];
+    path->start = unit->sprite->position;
+    path->end = end;
+    path->next_pos = Point(path->values[0], path->values[1]);
+    path->start_frame = *bw::frame_count;
+    path->flags = 0;
+    path->unk_count = 0;
+    path->total_region_count = std::min(regions->size(), (size_t)0xff);
+    path->unk1c = region_count;
+    path->unk1d = 0;
+    path->position_count = position_count;
+    path->position_index = 0;
+    return true;
+}
+
 #ifdef CONSOLE
 
 void DrawRegionBorders(uint8_t *framebuf, int w, int h)
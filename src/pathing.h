@@ -3,6 +3,8 @@
 
 #include "types.h"
 
+#include <vector>
+
 const unsigned int PATH_LIMIT = 0x400;
 
 int GetRegion(const Point &pos);
@@ -13,8 +15,32 @@ namespace Pathing {
 void DrawPathingInfo(uint8_t *framebuf, xuint w, yuint h);
 Path *AllocatePath(uint16_t *region_count, uint16_t *position_count);
 void CreateSimplePath(Unit *unit, const Point &next_pos, const Point &end);
+/// Clears dodge_unit of every path which is dodging unit. Goes through the allocated
+/// paths instead of all units, as only moving ground units have a path.
+void ClearDodgeReferences(const Unit *unit);
 Pathing::PathingSystem *GetPathingSystem();
 
+/// Copies the region graph FindRegionPath uses from bw's pathing data.
+/// Has to be called whenever the map's pathing is initialized or loaded.
+void InitRegionPaths();
+namespace Pathing {
+    /// Finds the regions between start_region and goal_region, both included, or returns
+    /// nullptr if there is no path. Units which search for the same regions during a frame
+    /// share the result, which is valid until the next frame.
+    /// Goals which are searched from many regions during a frame, like group moves, get
+    /// a flow field which is kept for the following frames as well.
+    const std::vector<uint16_t> *FindRegionPath(int start_region, int goal_region);
+}
+/// Like bw's MakePath, but only goes through centers of the regions found by FindRegionPath,
+/// without avoiding terrain inside regions or other units. Returns false if end cannot be reached.
+bool CreateRegionPath(Unit *unit, const Point &end);
+/// Ground unit movement uses CreateRegionPath instead of bw's MakePath, falling back to
+/// MakePath if there is no region path. Not bw-compatible, so all players have to use the
+/// same setting. Enabled with the TEIPPI_REGION_PATHS environment variable.
+extern bool region_path_movement;
+/// Writes the region graph in the format tools/pathbench.cpp reads
+bool DumpPathingData(const char *filename);
+
 extern bool draw_region_borders;
 extern bool draw_region_data;
 extern bool draw_paths;
@@ -0,0 +1,290 @@
+#include "region_path.h"
+
+#include <algorithm>
+#include <functional>
+#include <math.h>
+#include <string.h>
+
+namespace Pathing {
+
+static const char FileMagic[4] = { 'R', 'P', 'T', 'H' };
+static const uint32_t FileVersion = 1;
+
+void RegionGraph::Clear()
+{
+    nodes.clear();
+    neighbours.clear();
+}
+
+void RegionGraph::AddRegion(int32_t x, int32_t y, uint16_t group, const uint16_t *neighbour_ids, int neighbour_count)
+{
+    Node node;
+    node.x = x;
+    node.y = y;
+    node.group = group;
+    node.neighbour_count = neighbour_count;
+    node.first_neighbour = neighbours.size();
+    nodes.push_back(node);
+    neighbours.insert(neighbours.end(), neighbour_ids, neighbour_ids + neighbour_count);
+}
+
+void RegionGraph::Write(FILE *file) const
+{
+    uint32_t count = nodes.size();
+    fwrite(FileMagic, 1, sizeof FileMagic, file);
+    fwrite(&FileVersion, 1, sizeof FileVersion, file);
+    fwrite(&count, 1, sizeof count, file);
+    for (const Node &node : nodes)
+    {
+        fwrite(&node.x, 1, sizeof node.x, file);
+        fwrite(&node.y, 1, sizeof node.y, file);
+        fwrite(&node.group, 1, sizeof node.group, file);
+        fwrite(&node.neighbour_count, 1, sizeof node.neighbour_count, file);
+        fwrite(Neighbours(node), sizeof(uint16_t), node.neighbour_count, file);
+    }
+}
+
+bool RegionGraph::Read(FILE *file)
+{
+    Clear();
+    char magic[4];
+    uint32_t version, count;
+    if (fread(magic, 1, sizeof magic, file) != sizeof magic || memcmp(magic, FileMagic, sizeof magic) != 0)
+        return false;
+    if (fread(&version, 1, sizeof version, file) != sizeof version || version != FileVersion)
+        return false;
+    if (fread(&count, 1, sizeof count, file) != sizeof count || count > 0x10000)
+        return false;
+    std::vector<uint16_t> buf;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int32_t x, y;
+        uint16_t group, neighbour_count;
+        if (fread(&x, 1, sizeof x, file) != sizeof x || fread(&y, 1, sizeof y, file) != sizeof y ||
+            fread(&group, 1, sizeof group, file) != sizeof group ||
+            fread(&neighbour_count, 1, sizeof neighbour_count, file) != sizeof neighbour_count)
+        {
+            return false;
+        }
+        buf.resize(neighbour_count);
+        if (fread(buf.data(), sizeof(uint16_t), neighbour_count, file) != neighbour_count)
+            return false;
+        AddRegion(x, y, group, buf.data(), neighbour_count);
+    }
+    for (uint16_t neighbour : neighbours)
+    {
+        if (neighbour >= count)
+            return false;
+    }
+    return true;
+}
+
+/// Rounds up for the costs and down for the estimate, so that the estimate
+/// never exceeds the actual cost and the search finds the shortest path
+static uint32_t Distance(const RegionGraph::Node &a, const RegionGraph::Node &b, bool round_up)
+{
+    double x = a.x - b.x;
+    double y = a.y - b.y;
+    double dist = sqrt(x * x + y * y);
+    return round_up ? (uint32_t)ceil(dist) : (uint32_t)dist;
+}
+
+uint32_t RegionGraph::StepCost(uint16_t from, uint16_t to) const
+{
+    return Distance(nodes[from], nodes[to], true);
+}
+
+uint32_t RegionGraph::PathCost(const std::vector<uint16_t> &path) const
+{
+    uint32_t cost = 0;
+    for (uint32_t i = 1; i < path.size(); i++)
+        cost += StepCost(path[i - 1], path[i]);
+    return cost;
+}
+
+bool RegionPathfinder::FindPath(const RegionGraph &graph, uint16_t start, uint16_t goal, std::vector<uint16_t> *out)
+{
+    out->clear();
+    if (start >= graph.RegionCount() || goal >= graph.RegionCount())
+        return false;
+    const RegionGraph::Node &goal_node = graph.Region(goal);
+    if (graph.Region(start).group != goal_node.group)
+        return false;
+
+    if (states.size() < graph.RegionCount())
+        states.resize(graph.RegionCount(), State { 0, 0, 0, false });
+    generation += 1;
+    if (generation == 0)
+    {
+        for (State &state : states)
+            state.generation = 0;
+        generation = 1;
+    }
+    // The heap is a min-heap, so it compares with greater
+    auto heap_cmp = std::greater<OpenEntry>();
+    open.clear();
+    states[start] = State { generation, 0, start, false };
+    open.emplace_back(Distance(graph.Region(start), goal_node, false), start);
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), heap_cmp);
+        uint16_t region = open.back().second;
+        open.pop_back();
+        State &state = states[region];
+        if (state.closed)
+            continue;
+        state.closed = true;
+        visited_nodes += 1;
+        if (region == goal)
+        {
+            for (uint16_t pos = goal; pos != start; pos = states[pos].parent)
+                out->push_back(pos);
+            out->push_back(start);
+            std::reverse(out->begin(), out->end());
+            return true;
+        }
+
+        const RegionGraph::Node &node = graph.Region(region);
+        const uint16_t *neighbours = graph.Neighbours(node);
+        for (int i = 0; i < node.neighbour_count; i++)
+        {
+            uint16_t neighbour = neighbours[i];
+            const RegionGraph::Node &neighbour_node = graph.Region(neighbour);
+            uint32_t cost = state.cost + Distance(node, neighbour_node, true);
+            State &next = states[neighbour];
+            if (next.generation == generation && (next.closed || next.cost <= cost))
+                continue;
+            next = State { generation, cost, region, false };
+            open.emplace_back(cost + Distance(neighbour_node, goal_node, false), neighbour);
+            std::push_heap(open.begin(), open.end(), heap_cmp);
+        }
+    }
+    return false;
+}
+
+const uint16_t RegionFlowField::NoRegion;
+
+void RegionFlowField::Calculate(const RegionGraph &graph, uint16_t goal_region)
+{
+    typedef std::pair<uint32_t, uint16_t> OpenEntry;
+    goal = goal_region;
+    distances.assign(graph.RegionCount(), 0xffffffff);
+    next.assign(graph.RegionCount(), NoRegion);
+    std::vector<OpenEntry> open;
+    auto heap_cmp = std::greater<OpenEntry>();
+    distances[goal] = 0;
+    open.emplace_back(0, goal);
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), heap_cmp);
+        OpenEntry current = open.back();
+        open.pop_back();
+        uint16_t region = current.second;
+        if (current.first != distances[region])
+            continue;
+        const RegionGraph::Node &node = graph.Region(region);
+        const uint16_t *neighbours = graph.Neighbours(node);
+        for (int i = 0; i < node.neighbour_count; i++)
+        {
+            uint16_t neighbour = neighbours[i];
+            uint32_t distance = current.first + graph.StepCost(neighbour, region);
+            if (distance < distances[neighbour])
+            {
+                distances[neighbour] = distance;
+                next[neighbour] = region;
+                open.emplace_back(distance, neighbour);
+                std::push_heap(open.begin(), open.end(), heap_cmp);
+            }
+        }
+    }
+}
+
+bool RegionFlowField::FindPath(uint16_t start, std::vector<uint16_t> *out) const
+{
+    out->clear();
+    if (start >= next.size() || (start != goal && next[start] == NoRegion))
+        return false;
+    for (uint16_t pos = start; pos != goal; pos = next[pos])
+        out->push_back(pos);
+    out->push_back(goal);
+    return true;
+}
+
+const RegionFlowField *RegionPathCache::FindFlowField(const RegionGraph &graph, uint16_t goal)
+{
+    for (FlowFieldEntry &entry : flow_fields)
+    {
+        if (entry.field.Goal() == goal)
+        {
+            entry.last_used_epoch = epoch;
+            return &entry.field;
+        }
+    }
+    if (!use_flow_fields || goal_searches[goal] < FlowFieldThreshold)
+        return nullptr;
+
+    FlowFieldEntry *entry;
+    if (flow_fields.size() < MaxFlowFields)
+    {
+        flow_fields.emplace_back();
+        entry = &flow_fields.back();
+    }
+    else
+    {
+        entry = &*std::min_element(flow_fields.begin(), flow_fields.end(),
+                [](const FlowFieldEntry &a, const FlowFieldEntry &b) { return a.last_used_epoch < b.last_used_epoch; });
+    }
+    entry->field.Calculate(graph, goal);
+    entry->last_used_epoch = epoch;
+    return &entry->field;
+}
+
+const std::vector<uint16_t> *RegionPathCache::FindPath(const RegionGraph &graph, RegionPathfinder *pathfinder,
+        uint16_t start, uint16_t goal, uint32_t new_epoch)
+{
+    if (new_epoch != epoch)
+    {
+        paths.clear();
+        goal_searches.clear();
+        epoch = new_epoch;
+    }
+    uint32_t key = (uint32_t)start << 16 | goal;
+    auto result = paths.emplace(key, Entry());
+    Entry &entry = result.first->second;
+    if (!result.second)
+    {
+        hits += 1;
+        return entry.found ? &entry.regions : nullptr;
+    }
+
+    misses += 1;
+    const RegionFlowField *flow_field = nullptr;
+    if (start < graph.RegionCount() && goal < graph.RegionCount() &&
+            graph.Region(start).group == graph.Region(goal).group)
+    {
+        goal_searches[goal] += 1;
+        flow_field = FindFlowField(graph, goal);
+    }
+    if (flow_field != nullptr)
+    {
+        flow_field_paths += 1;
+        entry.found = flow_field->FindPath(start, &entry.regions);
+    }
+    else
+    {
+        entry.found = pathfinder->FindPath(graph, start, goal, &entry.regions);
+    }
+    return entry.found ? &entry.regions : nullptr;
+}
+
+void RegionPathCache::Clear()
+{
+    paths.clear();
+    goal_searches.clear();
+    flow_fields.clear();
+    hits = 0;
+    misses = 0;
+    flow_field_paths = 0;
+}
+
+} // namespace Pathing
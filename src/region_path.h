@@ -0,0 +1,163 @@
+#ifndef REGION_PATH_H
+#define REGION_PATH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Kept free of game headers, as it is also used by tools/pathbench.cpp
+
+namespace Pathing {
+
+/// Region connectivity of the map, copied from PathingSystem so that the pathfinder
+/// does not have to follow bw's pointers. Only neighbours which can be walked to are
+/// included, so regions of different groups never connect.
+class RegionGraph
+{
+    public:
+        struct Node
+        {
+            /// Center of the region in pixels
+            int32_t x;
+            int32_t y;
+            uint16_t group;
+            uint16_t neighbour_count;
+            uint32_t first_neighbour;
+        };
+
+        void Clear();
+        /// Regions have to be added in order of their ids
+        void AddRegion(int32_t x, int32_t y, uint16_t group, const uint16_t *neighbours, int neighbour_count);
+
+        uint32_t RegionCount() const { return nodes.size(); }
+        const Node &Region(uint16_t id) const { return nodes[id]; }
+        const uint16_t *Neighbours(const Node &node) const { return neighbours.data() + node.first_neighbour; }
+        /// Cost of moving between two neighbouring regions, as the pathfinders use it
+        uint32_t StepCost(uint16_t from, uint16_t to) const;
+        /// Sum of StepCost over the path
+        uint32_t PathCost(const std::vector<uint16_t> &path) const;
+
+        /// The format written by the `pathingdata` console command
+        void Write(FILE *file) const;
+        /// Returns false if the file is not valid pathing data
+        bool Read(FILE *file);
+
+    private:
+        std::vector<Node> nodes;
+        std::vector<uint16_t> neighbours;
+};
+
+/// A* over RegionGraph, using the distances between region centers.
+/// Reuses its buffers between searches, so one instance should not be shared between threads.
+class RegionPathfinder
+{
+    public:
+        RegionPathfinder() : generation(0), visited_nodes(0) {}
+
+        /// Writes the regions from start to goal, both included, to out.
+        /// Returns false if goal cannot be reached.
+        bool FindPath(const RegionGraph &graph, uint16_t start, uint16_t goal, std::vector<uint16_t> *out);
+
+        /// Amount of regions taken from the open list, summed over all searches
+        uint64_t VisitedNodes() const { return visited_nodes; }
+
+    private:
+        struct State
+        {
+            /// The other values are valid only if generation matches the pathfinder's
+            uint32_t generation;
+            uint32_t cost;
+            uint16_t parent;
+            bool closed;
+        };
+        /// (Estimated total cost, region), ties are broken by the region id so that
+        /// the result does not depend on the heap implementation
+        typedef std::pair<uint32_t, uint16_t> OpenEntry;
+
+        std::vector<State> states;
+        std::vector<OpenEntry> open;
+        uint32_t generation;
+        uint64_t visited_nodes;
+};
+
+/// Distances from every region to a single goal region, and the neighbour to move to
+/// next from each region. Lets any amount of units moving to the goal find their path
+/// without a search of their own.
+class RegionFlowField
+{
+    public:
+        static const uint16_t NoRegion = 0xffff;
+
+        /// Dijkstra from goal over the regions of its group
+        void Calculate(const RegionGraph &graph, uint16_t goal);
+
+        uint16_t Goal() const { return goal; }
+        /// Writes the regions from start to goal, both included, to out.
+        /// Returns false if goal cannot be reached.
+        bool FindPath(uint16_t start, std::vector<uint16_t> *out) const;
+
+    private:
+        uint16_t goal;
+        std::vector<uint32_t> distances;
+        /// NoRegion for the goal and regions which cannot reach it
+        std::vector<uint16_t> next;
+};
+
+/// Remembers paths between regions for as long as the epoch stays same, so that units
+/// which are moving from the same region to the same destination only need one search.
+/// If flow fields are enabled, a goal which gets searched from several regions during an
+/// epoch gets a RegionFlowField, which is kept over epochs until the cache is cleared.
+class RegionPathCache
+{
+    public:
+        /// Searches from this many different regions during an epoch create a flow field
+        static const uint32_t FlowFieldThreshold = 8;
+        /// The least recently used flow field gets replaced after this
+        static const uint32_t MaxFlowFields = 16;
+
+        RegionPathCache() : epoch(0), use_flow_fields(true), hits(0), misses(0), flow_field_paths(0) {}
+
+        /// Returns nullptr if there is no path. The returned regions are valid until
+        /// the cache is cleared or called with a different epoch.
+        const std::vector<uint16_t> *FindPath(const RegionGraph &graph, RegionPathfinder *pathfinder,
+                uint16_t start, uint16_t goal, uint32_t epoch);
+        /// Has to be called when the graph changes
+        void Clear();
+        void SetUseFlowFields(bool enable) { use_flow_fields = enable; flow_fields.clear(); }
+
+        uint32_t Hits() const { return hits; }
+        uint32_t Misses() const { return misses; }
+        /// Misses which used a flow field instead of searching
+        uint32_t FlowFieldPaths() const { return flow_field_paths; }
+        uint32_t FlowFieldCount() const { return flow_fields.size(); }
+
+    private:
+        struct Entry
+        {
+            bool found;
+            std::vector<uint16_t> regions;
+        };
+        struct FlowFieldEntry
+        {
+            RegionFlowField field;
+            uint32_t last_used_epoch;
+        };
+
+        const RegionFlowField *FindFlowField(const RegionGraph &graph, uint16_t goal);
+
+        std::unordered_map<uint32_t, Entry> paths;
+        /// Searches done to each goal during the current epoch
+        std::unordered_map<uint16_t, uint32_t> goal_searches;
+        std::vector<FlowFieldEntry> flow_fields;
+        uint32_t epoch;
+        bool use_flow_fields;
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t flow_field_paths;
+};
+
+} // namespace Pathing
+
+#endif /* REGION_PATH_H */
@@ -1,6 +1,7 @@
 #include "replay.h"
 
 #include <string.h>
+#include <algorithm>
 
 #include "offsets.h"
 #include "game.h"
@@ -11,12 +12,211 @@
 #include "mapdirectory.h"
 #include "console/windows_wrap.h"
 #include "warn.h"
+#include "yms.h"
 
 using std::min;
 
 const uint32_t ReplayMagic = 0x4c526572;
 const uint32_t OldReplayMagic = 0x53526572;
 
+struct ReplayCommand
+{
+    constexpr ReplayCommand(int net_player, const uint8_t *beg, const uint8_t *end) :
+        net_player(net_player), beg(beg), end(end) { }
+    uint8_t net_player;
+    const uint8_t *beg;
+    const uint8_t *end;
+};
+
+/// Flat frame -> command span table of the replay command stream.
+///
+/// Bw's replay command buffer is parsed once when it gets loaded, instead of
+/// parsing the commands every frame during playback. The command pointers point
+/// to the buffer in ReplayData, so the index has to be rebuilt if the buffer changes,
+/// which can be checked with IsBuiltFor().
+class ReplayCommandIndex
+{
+    public:
+        ReplayCommandIndex() { Clear(); }
+
+        void Clear()
+        {
+            commands.clear();
+            frames.clear();
+            data = nullptr;
+            length = 0;
+            cursor = 0;
+            error_frame = UINT32_MAX;
+            error[0] = 0;
+            players_resolved = false;
+        }
+
+        bool IsBuiltFor(const ReplayData *replay_data) const
+        {
+            return data != nullptr && data == replay_data->beg && length == replay_data->length_bytes;
+        }
+
+        void Build(const ReplayData *replay_data)
+        {
+            Clear();
+            data = replay_data->beg;
+            length = replay_data->length_bytes;
+            if (data == nullptr)
+                return;
+
+            const uint8_t *pos = data;
+            const uint8_t *data_end = data + length;
+            // Commands are not kept in separate vectors per frame, so vector<ReplayCommand>
+            // would be reallocated a lot without reserving. Most commands are few bytes long.
+            commands.reserve(length / 8);
+            while (pos + sizeof(uint32_t) + 1 < data_end)
+            {
+                uint32_t frame = *(const uint32_t *)pos;
+                if (!frames.empty() && frame < frames.back().frame)
+                {
+                    // The bogus frame has already passed, so the error is shown
+                    // after executing the last valid frame, like bw's parser would
+                    SetError(frames.back().frame, "Got frame %d, expected at least %d", frame, frames.back().frame);
+                    return;
+                }
+                pos += 4;
+                int replay_cmd_len = *pos;
+                pos += 1;
+                const uint8_t *cmd_end = std::min(pos + replay_cmd_len, data_end);
+                if (frames.empty() || frames.back().frame != frame)
+                    frames.emplace_back(frame, commands.size());
+                while (pos < cmd_end)
+                {
+                    int player = *pos;
+                    pos += 1;
+                    if (pos == cmd_end)
+                    {
+                        SetError(frame, "Command ends suddenly");
+                        return;
+                    }
+                    int cmd_len = CommandLength(pos, cmd_end - pos);
+                    if (pos + cmd_len > cmd_end || cmd_len <= 0)
+                    {
+                        SetError(frame, "Invalid length %d for command %x", cmd_len, pos[0]);
+                        return;
+                    }
+                    commands.emplace_back(player, pos, pos + cmd_len);
+                    pos += cmd_len;
+                }
+                frames.back().end = commands.size();
+                frames.back().data_end = pos - data;
+            }
+        }
+
+        /// Resolves net player ids to the players who send the commands (unique ids).
+        /// The main player of a team may change during the game, so the caller has to
+        /// look it up when executing the command.
+        void ResolvePlayers(const Player *players)
+        {
+            std::fill(std::begin(unique_ids), std::end(unique_ids), -1);
+            // Iterating backwards, as the first player with matching storm id is used
+            for (int i = Limits::ActivePlayers - 1; i >= 0; i--)
+            {
+                int net_player = players[i].storm_id;
+                if (net_player < 0 || net_player > 0xff)
+                    continue;
+                unique_ids[net_player] = i;
+            }
+            players_resolved = true;
+        }
+
+        /// ResolvePlayers() has to be called again if the storm ids of players change,
+        /// e.g. when someone leaves
+        bool PlayersResolved() const { return players_resolved; }
+        /// -1 if the net player does not control any player
+        int UniqueId(const ReplayCommand &cmd) const { return unique_ids[cmd.net_player]; }
+
+        /// Returns commands of `frame`. Frames are expected to be requested in increasing
+        /// order, otherwise the span is searched from the entire table.
+        /// Updates replay_data->pos to match what bw would have.
+        Array<const ReplayCommand> CommandsForFrame(uint32_t frame, ReplayData *replay_data)
+        {
+            if (cursor != 0 && (cursor > frames.size() || frames[cursor - 1].frame >= frame))
+            {
+                auto it = std::lower_bound(frames.begin(), frames.end(), frame, [](const auto &a, uint32_t b) {
+                    return a.frame < b;
+                });
+                cursor = it - frames.begin();
+            }
+            while (cursor < frames.size() && frames[cursor].frame < frame)
+                cursor++;
+            if (cursor == frames.size() || frames[cursor].frame != frame)
+                return Array<const ReplayCommand>(commands.data(), 0);
+
+            const FrameSpan &span = frames[cursor];
+            cursor++;
+            replay_data->pos = replay_data->beg + span.data_end;
+            return Array<const ReplayCommand>(commands.data() + span.begin, commands.data() + span.end);
+        }
+
+        /// If the stream was corrupted, the commands after that point are not available.
+        /// Returns the description of the error if frame is the last frame that was parsed.
+        const char *ErrorAtFrame(uint32_t frame) const
+        {
+            if (frame == error_frame)
+                return error;
+            return nullptr;
+        }
+
+        /// UINT32_MAX if the stream is not corrupted
+        uint32_t ErrorFrame() const { return error_frame; }
+        const char *Error() const { return error; }
+
+        template <class Cb>
+        void ForEachCommand(Cb cb) const
+        {
+            for (const FrameSpan &span : frames)
+            {
+                for (uint32_t i = span.begin; i < span.end; i++)
+                    cb(span.frame, commands[i]);
+            }
+        }
+
+        uint32_t LastFrame() const { return frames.empty() ? 0 : frames.back().frame; }
+        uint32_t CommandCount() const { return commands.size(); }
+
+    private:
+        struct FrameSpan
+        {
+            FrameSpan(uint32_t frame, uint32_t begin) : frame(frame), begin(begin), end(begin), data_end(0) { }
+            uint32_t frame;
+            uint32_t begin;
+            uint32_t end;
+            /// Offset in ReplayData::beg where the next frame begins
+            uint32_t data_end;
+        };
+
+        template <class... Args>
+        void SetError(uint32_t frame, const char *format, Args... args)
+        {
+            error_frame = frame;
+            snprintf(error, sizeof error, format, args...);
+            // The commands parsed before the error are still executed
+            if (!frames.empty() && frames.back().frame == frame)
+            {
+                frames.back().end = commands.size();
+                frames.back().data_end = length;
+            }
+        }
+
+        vector<ReplayCommand> commands;
+        vector<FrameSpan> frames;
+        const uint8_t *data;
+        uint32_t length;
+        uint32_t cursor;
+        uint32_t error_frame;
+        char error[96];
+        bool players_resolved;
+        int8_t unique_ids[0x100];
+};
+
+static ReplayCommandIndex replay_index;
+
 static bool WriteReplay(File *replay)
 {
     uint32_t magic = ReplayMagic;
@@ -95,6 +295,7 @@ bool LoadReplayData(File *filu, uint32_t *error)
     bw::AllocateReplayCommands();
     if (!bw::LoadReplayCommands(filu))
         return false;
+    replay_index.Build(*bw::replay_data);
     if (!bw::ReadCompressed(bw::scenario_chk_length.raw_pointer(), 4, filu))
         return false;
     if (*bw::scenario_chk)
@@ -209,77 +410,16 @@ void LoadReplayMapDirEntry(MapDirEntry *mde)
     mde->unk25c = 0;
 }
 
-struct ReplayCommand
+void ClearReplayIndex()
 {
-    constexpr ReplayCommand(int net_player, const uint8_t *beg, const uint8_t *end) :
-        net_player(net_player), beg(beg), end(end) { }
-    int net_player;
-    const uint8_t *beg;
-    const uint8_t *end;
-};
+    replay_index.Clear();
+}
 
-/// Currently meant to be created each time when replay commands are to be run,
-/// and advances the pointers in the ReplayData that gets passed to it (if needed).
-struct ReplayCommands
+static void WarnCorruptedReplay(const char *error)
 {
-    /// Modifies the pointers of replay_data.
-    /// Assumes that replay_data is at either current frame or a future frame.
-    ReplayCommands(ReplayData *replay_data, uint32_t frame)
-    {
-        const uint8_t *data_end = replay_data->beg + replay_data->length_bytes;
-        if (!replay_data->unk4 || replay_data->pos + sizeof(uint32_t) > data_end)
-            return;
-
-        uint32_t cmd_frame = *(const uint32_t *)replay_data->pos;
-        if (cmd_frame < frame)
-        {
-            Warn("Corrupted replay? Got frame %d, expected at least %d\n", cmd_frame, frame);
-            return;
-        }
-        if (cmd_frame > frame)
-            return;
-
-        // Is most likely enough most of the cases.
-        commands.reserve(8);
-        while (replay_data->pos + sizeof(uint32_t) + 1 < data_end && frame == *(const uint32_t *)replay_data->pos)
-        {
-            replay_data->pos += 4;
-            int replay_cmd_len = *replay_data->pos;
-            replay_data->pos += 1;
-            const uint8_t *cmd_end = replay_data->pos + replay_cmd_len;
-            cmd_end = std::min(cmd_end, data_end);
-            while (replay_data->pos < cmd_end)
-            {
-                int player = *replay_data->pos;
-                replay_data->pos += 1;
-                if (replay_data->pos == cmd_end)
-                {
-                    Warn("Corrupted replay? Command ends suddenly\n");
-                    return;
-                }
-                int cmd_len = CommandLength(replay_data->pos, cmd_end - replay_data->pos);
-                if (replay_data->pos + cmd_len > cmd_end || cmd_len <= 0)
-                {
-                    Warn("Corrupted replay? Invalid length %d for command %x\n", cmd_len, replay_data->pos[0]);
-                    return;
-                }
-                commands.emplace_back(player, replay_data->pos, replay_data->pos + cmd_len);
-                replay_data->pos += cmd_len;
-            }
-        }
-    }
-
-    template <class... Args>
-    void Warn(Args &&... args)
-    {
-        bw::ChangeReplaySpeed(*bw::game_speed, *bw::replay_speed_multiplier, 1);
-        Warning(std::forward<Args>(args)...);
-    }
-
-    ReplayCommands(ReplayCommands &&other) = default;
-    ReplayCommands& operator=(ReplayCommands &&other) = default;
-    vector<ReplayCommand> commands;
-};
+    bw::ChangeReplaySpeed(*bw::game_speed, *bw::replay_speed_multiplier, 1);
+    Warning("Corrupted replay? %s\n", error);
+}
 
 void ProgressReplay()
 {
@@ -291,31 +431,172 @@ void ProgressReplay()
         bw::Victory();
         return;
     }
-    ReplayCommands cmds(*bw::replay_data, *bw::frame_count);
+    ReplayData *replay_data = *bw::replay_data;
+    if (!replay_data->unk4)
+        return;
+    // The index gets built once when the replay is loaded, but bw might load the
+    // replay commands again without going through LoadReplayData.
+    if (!replay_index.IsBuiltFor(replay_data))
+        replay_index.Build(replay_data);
+    if (!replay_index.PlayersResolved())
+        replay_index.ResolvePlayers(&bw::players[0]);
+
+    auto cmds = replay_index.CommandsForFrame(*bw::frame_count, replay_data);
     *bw::use_rng = 1;
-    for (const auto &cmd : cmds.commands)
+    for (const ReplayCommand &cmd : cmds)
     {
-        int player_id = -1;
-        int unique_id = -1;
-        for (int i = 0; i < Limits::ActivePlayers; i++)
-        {
-            if (bw::players[i].storm_id == cmd.net_player)
-            {
-                unique_id = i;
-                if (*bw::team_game)
-                    player_id = bw::team_game_main_player[bw::players[i].team - 1];
-                else
-                    player_id = i;
-                break;
-            }
-        }
-        if (player_id == -1)
+        int unique_id = replay_index.UniqueId(cmd);
+        if (unique_id == -1)
             continue;
-        *bw::command_user = player_id;
+        if (*bw::team_game)
+            *bw::command_user = bw::team_game_main_player[bw::players[unique_id].team - 1];
+        else
+            *bw::command_user = unique_id;
         *bw::select_command_user = unique_id;
         // Unnecessary?
         *bw::keep_alive_count = 0;
         ProcessCommands(cmd.beg, cmd.end - cmd.beg, 1);
+        // Leaving may change the storm ids of players, which has to affect the following commands
+        if (cmd.beg[0] == commands::LeaveGame)
+            replay_index.ResolvePlayers(&bw::players[0]);
     }
     *bw::use_rng = 0;
+    const char *error = replay_index.ErrorAtFrame(*bw::frame_count);
+    if (error != nullptr)
+        WarnCorruptedReplay(error);
+}
+
+uint32_t FindReplayCorruption(const ReplayData *replay_data)
+{
+    ReplayCommandIndex index;
+    index.Build(replay_data);
+    return index.ErrorFrame();
+}
+
+/// Game frames are 42 ms on fastest speed, which is what apm is usually measured at
+static double FramesToMinutes(uint32_t frames)
+{
+    return frames * 42.0 / 1000.0 / 60.0;
+}
+
+static bool IsApmCommand(uint8_t command)
+{
+    switch (command)
+    {
+        case commands::KeepAlive:
+        case commands::Sync:
+        case commands::Latency:
+        case commands::ReplaySpeed:
+        case commands::LeaveGame:
+        case commands::Pause:
+        case commands::Resume:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static void WriteReplayStats(const ReplayCommandIndex &index, const Player *players, FILE *out)
+{
+    uint32_t commands[Limits::ActivePlayers][0x100] = {};
+    uint32_t actions[Limits::ActivePlayers] = {};
+    uint32_t last_action_frame[Limits::ActivePlayers] = {};
+    uint32_t unresolved = 0;
+    index.ForEachCommand([&](uint32_t frame, const ReplayCommand &cmd) {
+        int unique_id = index.UniqueId(cmd);
+        if (unique_id == -1)
+        {
+            unresolved++;
+            return;
+        }
+        commands[unique_id][cmd.beg[0]] += 1;
+        if (IsApmCommand(cmd.beg[0]))
+        {
+            actions[unique_id] += 1;
+            last_action_frame[unique_id] = frame;
+        }
+    });
+
+    uint32_t end_frame = std::max(bw::replay_header->replay_end_frame, index.LastFrame());
+    fprintf(out, "Frames: %d (%.1f minutes), %d commands\n", end_frame, FramesToMinutes(end_frame),
+            index.CommandCount());
+    if (unresolved != 0)
+        fprintf(out, "%d commands from unknown players\n", unresolved);
+    if (index.ErrorFrame() != UINT32_MAX)
+        fprintf(out, "Corrupted at frame %d: %s\n", index.ErrorFrame(), index.Error());
+    for (int i = 0; i < Limits::ActivePlayers; i++)
+    {
+        if (actions[i] == 0 && std::all_of(std::begin(commands[i]), std::end(commands[i]),
+                                           [](uint32_t x) { return x == 0; }))
+        {
+            continue;
+        }
+        double minutes = FramesToMinutes(last_action_frame[i]);
+        double apm = minutes == 0.0 ? 0.0 : actions[i] / minutes;
+        fprintf(out, "\nPlayer %d (%s): %d actions, %.1f apm\n", i, players[i].name, actions[i], apm);
+        for (int cmd = 0; cmd < 0x100; cmd++)
+        {
+            if (commands[i][cmd] != 0)
+                fprintf(out, "    %02x: %d\n", cmd, commands[i][cmd]);
+        }
+    }
+}
+
+bool DumpReplayStats(const char *out_filename)
+{
+    if (!IsReplay() || !replay_index.IsBuiltFor(*bw::replay_data))
+        return false;
+    FILE *out = fopen(out_filename, "w");
+    if (out == nullptr)
+        return false;
+    WriteReplayStats(replay_index, &bw::players[0], out);
+    fclose(out);
+    return true;
+}
+
+bool DumpReplayStats(const char *replay_filename, const char *out_filename)
+{
+    if (IsInGame())
+        return false;
+    uint32_t error;
+    if (!LoadReplayData(replay_filename, &error))
+        return false;
+
+    GameData game_data;
+    Player players[Limits::Players];
+    bw::ReadStruct245(&game_data, players);
+    ReplayCommandIndex index;
+    index.Build(*bw::replay_data);
+    index.ResolvePlayers(players);
+    FILE *out = fopen(out_filename, "w");
+    if (out == nullptr)
+        return false;
+    fprintf(out, "%s\n", replay_filename);
+    WriteReplayStats(index, players, out);
+    fclose(out);
+    return true;
+}
+
+bool DumpReplayCommands(const char *replay_filename, const char *out_filename)
+{
+    if (replay_filename == nullptr)
+    {
+        if (!IsReplay())
+            return false;
+    }
+    else
+    {
+        if (IsInGame())
+            return false;
+        uint32_t error;
+        if (!LoadReplayData(replay_filename, &error))
+            return false;
+    }
+    const ReplayData *replay_data = *bw::replay_data;
+    FILE *out = fopen(out_filename, "wb");
+    if (out == nullptr)
+        return false;
+    fwrite(replay_data->beg, 1, replay_data->length_bytes, out);
+    fclose(out);
+    return true;
 }
@@ -7,6 +7,19 @@ uint32_t LoadReplayData(const char *filename, uint32_t *error);
 void LoadReplayMapDirEntry(MapDirEntry *mde);
 void ProgressReplay();
 void SaveReplay(const char *name, bool overwrite);
+void ClearReplayIndex();
+
+/// Writes apm and command counts of each player to a text file.
+/// The first one uses the replay that is currently being watched, the second one
+/// loads a replay file without starting a game, and cannot be used while in game.
+bool DumpReplayStats(const char *out_filename);
+bool DumpReplayStats(const char *replay_filename, const char *out_filename);
+/// Returns the frame after which playback warns that the replay commands are corrupted,
+/// or UINT32_MAX if they are not.
+uint32_t FindReplayCorruption(const ReplayData *replay_data);
+/// Writes the raw command data of a replay, which tools/cmdbench.cpp can use.
+/// Replay_filename may be nullptr to use the replay that is currently being watched.
+bool DumpReplayCommands(const char *replay_filename, const char *out_filename);
 
 #pragma pack(push, 1)
 struct ReplayHeader
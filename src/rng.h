@@ -45,4 +45,60 @@ inline Rng *MainRng()
     return (Rng *)bw::rng_seed.raw_pointer();
 }
 
+/// Not bw-compatible, so only for mods and custom games (and all players have to agree on it,
+/// or the game will desync): Iscript of each unit, bullet and sprite draws from a stream of its
+/// own instead of the main rng. The streams only depend on the main seed at start of the frame,
+/// the object's id and the frame, so objects may be progressed in any order, or in parallel,
+/// without the results changing. Enabled with the TEIPPI_OBJECT_RNG environment variable.
+extern bool object_rng_streams;
+/// Main seed at the start of current frame, set by StartObjectRngFrame()
+extern uint32_t object_rng_frame_seed;
+
+/// Has to be called before any objects are progressed
+inline void StartObjectRngFrame()
+{
+    object_rng_frame_seed = *bw::rng_seed;
+}
+
+inline uint32_t MixRngSeed(uint32_t seed, uint32_t value)
+{
+    uint32_t hash = seed ^ (value * 0x9e3779b9);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/// Rng stream of a single object, stored in its sprite
+class ObjectRng
+{
+    public:
+        /// Object kinds, so that ids of different kinds get different streams
+        static const uint32_t Unit = 0;
+        static const uint32_t Bullet = 1;
+        static const uint32_t Sprite = 2;
+
+        constexpr ObjectRng() : rng { 0 }, frame(0xffffffff) {}
+
+        /// Returns MainRng() if object_rng_streams is not enabled. Otherwise returns the stream,
+        /// which restarts every frame, but continues if used several times during a frame.
+        Rng *Get(uint32_t kind, uint32_t id)
+        {
+            if (!object_rng_streams)
+                return MainRng();
+            if (frame != *bw::frame_count)
+            {
+                frame = *bw::frame_count;
+                rng.seed = MixRngSeed(MixRngSeed(MixRngSeed(object_rng_frame_seed, frame), kind), id);
+            }
+            return &rng;
+        }
+
+    private:
+        Rng rng;
+        uint32_t frame;
+};
+
 #endif /* RNG_H */
@@ -34,6 +34,13 @@
 #define SEEK_SET 0
 #endif
 
+/// Units and sprites are saved as raw structs, so this has to be increased whenever
+/// their layout changes. 2 added the runtime-only private data of units and the rng
+/// stream of sprites.
+const uint32_t SaveVersion = 2;
+/// Older saves would be read with a different struct layout
+const uint32_t OldestSupportedSaveVersion = 2;
+
 const int buf_defaultmax = 0x110000;
 const int buf_defaultlimit = 0x100000;
 
@@ -924,6 +931,7 @@ void Save::SaveAiChunk()
     }
     int i = 0, i_pos = ftell(file);
     fwrite(&i, 1, 4, file);
+    Ai::UpdateScriptWaits();
     for (Ai::Script *script : *bw::first_active_ai_script)
     {
         CreateAiScriptSave(script);
@@ -998,7 +1006,7 @@ void Save::SaveGame(uint32_t time)
 
     uint32_t magic = ~0;
     fwrite(&magic, 1, 4, file);
-    uint32_t version = 1;
+    uint32_t version = SaveVersion;
     fwrite(&version, 1, 4, file);
     lone_sprites->Serialize(this);
     //SaveObjectChunk(&Save::CreateFlingySave, first_allocated_flingy);
@@ -1134,6 +1142,9 @@ std::pair<int, Unit *> Unit::SaveAllocate(uint8_t *in, uint32_t size, DummyListH
     Unit *in_unit = (Unit *)in;
     Unit *out = Unit::RawAlloc();
     memcpy(out, in_unit, sizeof(Unit));
+    out->sync_hash_private = SyncHashPrivate();
+    out->unit_search_private = UnitSearchPrivate();
+    out->combat_stats_private = CombatStatsPrivate();
     out->allocated.Add(*list_head);
     out->AddToLookup();
     size -= sizeof(Unit);
@@ -1368,6 +1379,7 @@ ptr<Sprite> Sprite::Deserialize(Load *load)
     {
         auto sprite = ptr<Sprite>(new Sprite);
         load->ReadCompressed(sprite.get(), sizeof(Sprite));
+        sprite->rng_stream = ObjectRng();
         uintptr_t count = (uintptr_t)sprite->first_overlay.AsRawPointer();
         uintptr_t main_image_id = (uintptr_t)sprite->main_image - 1;
         sprite->first_overlay = nullptr;
@@ -1414,6 +1426,7 @@ std::pair<int, Sprite *> Sprite::SaveAllocate(uint8_t *in, uint32_t size)
 
     Sprite *out = new Sprite;
     memcpy(out, in, sizeof(Sprite));
+    out->rng_stream = ObjectRng();
     in += sizeof(Sprite);
     out->first_overlay = 0;
     out->last_overlay = 0;
@@ -1843,6 +1856,12 @@ void Load::LoadGame()
         fseek(file, -4, SEEK_CUR);
         version = 0;
     }
+    if (version < OldestSupportedSaveVersion || version > SaveVersion)
+    {
+        char buf[64];
+        snprintf(buf, sizeof buf, "Unsupported save version %u", version);
+        throw SaveException(nullptr, buf);
+    }
     lone_sprites->Deserialize(this);
 //  LoadObjectChunk<Flingy, false>(&Flingy::SaveAllocate, &first_allocated_flingy, 0);
     bullet_system->Deserialize(this);
@@ -1888,12 +1907,7 @@ void Load::LoadGame()
         for (auto &group : player_hotkeys)
         {
             for (auto &unit : group)
-            {
-                if (version >= 1)
-                    LoadUnitPtr(&unit);
-                else
-                    unit = nullptr;
-            }
+                LoadUnitPtr(&unit);
         }
     }
 
@@ -1924,8 +1938,10 @@ void Load::LoadGame()
 
     LoadPathingChunk();
     unit_search->Init();
+    InitRegionPaths();
 
     LoadAiChunk();
+    Ai::ResetTimers();
     if (!bw::LoadDatChunk((File *)file, 0x3))
         throw SaveException();
     fread(bw::screen_x.raw_pointer(), 1, 4, file);
@@ -10,8 +10,10 @@
 #include "bullet.h"
 #include "game.h"
 #include "limits.h"
+#include "log.h"
 #include "pathing.h"
 #include "player.h"
+#include "replay.h"
 #include "resolution.h"
 #include "selection.h"
 #include "sprite.h"
@@ -123,6 +125,10 @@ ScConsole::ScConsole()
     AddCommand("test", &ScConsole::Test);
     AddCommand("spawn", &ScConsole::Spawn);
     AddCommand("ais_exec", &ScConsole::AiscriptExec);
+    AddCommand("replaystats", &ScConsole::ReplayStats);
+    AddCommand("replaycommands", &ScConsole::ReplayCommands);
+    AddCommand("pathingdata", &ScConsole::PathingData);
+    AddCommand("headless", &ScConsole::Headless);
     commands["dc"] = [this](const auto &a) { return this->Death(a, false, false); };
     commands["dc?"] = [this](const auto &a) { return this->Death(a, true, false); };
     commands["dc;"] = [this](const auto &a) { return this->Death(a, false, true); };
@@ -156,6 +162,12 @@ bool ScConsole::Test(const CmdArgs &args)
         if (!result) { Assert(result); }
         return true;
     }
+    else if (strcmp(args[1], "ai_targeteval") == 0)
+    {
+        bool result = Ai::TestTargetEvaluation();
+        if (!result) { Assert(result); }
+        return true;
+    }
     else
     {
         low = atoi(args[1]);
@@ -504,6 +516,7 @@ bool ScConsole::Give(const CmdArgs &args)
     for (Unit *unit : client_select)
     {
         bw::GiveUnit(unit, player, false);
+        unit_search->UpdateUnitOwner(unit);
     }
     return true;
 }
@@ -535,6 +548,7 @@ bool ScConsole::AiScript(const CmdArgs &args)
         uint32_t player = atoi(args[2]);
         uint32_t count = 0;
 
+        Ai::UpdateScriptWaits();
         for (Ai::Script *script : *bw::first_active_ai_script)
         {
             if (script->player == player)
@@ -753,6 +767,73 @@ bool ScConsole::Frame(const CmdArgs &args)
     return true;
 }
 
+bool ScConsole::ReplayStats(const CmdArgs &args)
+{
+    char out_filename[260];
+    snprintf(out_filename, sizeof out_filename, "%s/replay_stats.txt", log_path);
+    bool success;
+    if (args[1][0] == 0)
+    {
+        if (!IsInGame() || !IsReplay())
+        {
+            Printf("replaystats [replay file] (Without arguments only in a replay)");
+            return false;
+        }
+        success = DumpReplayStats(out_filename);
+    }
+    else
+        success = DumpReplayStats(args[1], out_filename);
+
+    if (success)
+        Printf("Wrote %s", out_filename);
+    return success;
+}
+
+bool ScConsole::ReplayCommands(const CmdArgs &args)
+{
+    char out_filename[260];
+    snprintf(out_filename, sizeof out_filename, "%s/replay_commands.bin", log_path);
+    bool success;
+    if (args[1][0] == 0)
+    {
+        if (!IsInGame() || !IsReplay())
+        {
+            Printf("replaycommands [replay file] (Without arguments only in a replay)");
+            return false;
+        }
+        success = DumpReplayCommands(nullptr, out_filename);
+    }
+    else
+        success = DumpReplayCommands(args[1], out_filename);
+
+    if (success)
+        Printf("Wrote %s", out_filename);
+    return success;
+}
+
+bool ScConsole::PathingData(const CmdArgs &args)
+{
+    if (!IsInGame())
+        return false;
+    char out_filename[260];
+    snprintf(out_filename, sizeof out_filename, "%s/pathing.bin", log_path);
+    if (!DumpPathingData(out_filename))
+        return false;
+    Printf("Wrote %s", out_filename);
+    return true;
+}
+
+bool ScConsole::Headless(const CmdArgs &args)
+{
+    if (args[1][0] == 0)
+    {
+        Printf("headless <end frame> (0 never exits)");
+        return false;
+    }
+    EnableHeadlessMode(strtoul(args[1], nullptr, 0));
+    return true;
+}
+
 bool ScConsole::Pause(const CmdArgs &args)
 {
     if (!IsInGame())
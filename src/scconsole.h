@@ -48,6 +48,10 @@ class ScConsole : public Common::GenericConsole
         bool Cmd_Grid(const CmdArgs &args);
 
         bool Frame(const CmdArgs &args);
+        bool ReplayStats(const CmdArgs &args);
+        bool ReplayCommands(const CmdArgs &args);
+        bool PathingData(const CmdArgs &args);
+        bool Headless(const CmdArgs &args);
         bool Show(const CmdArgs &args);
         bool Test(const CmdArgs &args);
         bool Spawn(const CmdArgs &args);
@@ -0,0 +1,9 @@
+#ifndef SCSTRING_H
+#define SCSTRING_H
+
+// Kept free of game headers, as it is also used by tools/cmdbench.cpp
+
+// retval 0 meinaa invalid / max len reached, 1 meinaa "" stringiä jne
+int Sc_strlen(const char *str, int maxlen1, int maxlen2, bool accept_color_chars, bool accept_control_chars);
+
+#endif /* SCSTRING_H */
@@ -494,11 +494,6 @@ int TrySelectRecentHotkeyGroup(Unit *unit)
     return 0;
 }
 
-int SelectCommandLength(const uint8_t *data)
-{
-    return *(uint32_t *)(data + 2) * 4 + 6;
-}
-
 static void RemoveFromHotkeyGroup(Unit *unit, int player, int group_id)
 {
     auto group = bw::selection_hotkeys[player][group_id];
@@ -6,8 +6,6 @@
 
 bool ShouldClearOrderTargeting();
 
-int SelectCommandLength(const uint8_t *data);
-
 void RemoveFromHotkeyGroups(Unit *unit);
 
 void Command_Select(const uint8_t *buf);
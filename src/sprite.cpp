@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 
 #include "constants/image.h"
 #include "constants/sprite.h"
@@ -14,6 +15,7 @@
 #include "perfclock.h"
 #include "resolution.h"
 #include "rng.h"
+#include "scthread.h"
 #include "selection.h"
 #include "unit.h"
 #include "yms.h"
@@ -29,15 +31,70 @@ uint32_t Sprite::draw_order_limit = 0x22DD0; // 0x150 * 0x6a4 / 0x4 (that is who
 Sprite **Sprite::draw_order = (Sprite **)bw::units.raw_pointer();
 int Sprite::draw_order_amount;
 
-#ifdef SYNC
+/// Sprites are allocated from chunks instead of one by one, as especially lone sprites get
+/// created and deleted all the time. Deleted sprites are reused, chunks are never freed.
+/// Sprites are only created and deleted by the main thread.
+class SpriteAllocator
+{
+    public:
+        static const int ChunkSize = 256;
+
+        SpriteAllocator() : free_list(nullptr) {}
+
+        void *Allocate()
+        {
+            if (free_list == nullptr)
+                NewChunk();
+            Slot *slot = free_list;
+            free_list = slot->next;
+            return slot;
+        }
+
+        void Free(void *ptr)
+        {
+            Slot *slot = (Slot *)ptr;
+            slot->next = free_list;
+            free_list = slot;
+        }
+
+    private:
+        union Slot
+        {
+            Slot *next;
+            uint8_t sprite[sizeof(Sprite)];
+        };
+
+        void NewChunk()
+        {
+            chunks.emplace_back(new Slot[ChunkSize]);
+            Slot *chunk = chunks.back().get();
+            for (int i = ChunkSize - 1; i >= 0; i--)
+            {
+                chunk[i].next = free_list;
+                free_list = &chunk[i];
+            }
+        }
+
+        vector<std::unique_ptr<Slot[]>> chunks;
+        Slot *free_list;
+};
+
+static SpriteAllocator sprite_allocator;
+
 void *Sprite::operator new(size_t size)
 {
-    auto ret = new uint8_t[size];
+    Assert(size == sizeof(Sprite));
+    auto ret = sprite_allocator.Allocate();
     if (SyncTest)
         ScrambleStruct(ret, size);
     return ret;
 }
-#endif
+
+void Sprite::operator delete(void *ptr)
+{
+    if (ptr != nullptr)
+        sprite_allocator.Free(ptr);
+}
 
 class SpriteIscriptContext : public Iscript::Context
 {
@@ -215,7 +272,7 @@ ptr<Sprite> Sprite::Allocate(Iscript::Context *ctx, SpriteType sprite_id, const
 Sprite *Sprite::AllocateWithBasicIscript(SpriteType sprite_id, const Point &pos, int player)
 {
     ptr<Sprite> sprite(new Sprite);
-    SpriteIscriptContext ctx(sprite.get(), MainRng(), "Sprite::AllocateWithBasicIscript", false);
+    SpriteIscriptContext ctx(sprite.get(), sprite->IscriptRng(), "Sprite::AllocateWithBasicIscript", false);
     if (!sprite->Initialize(&ctx, sprite_id, pos, player))
         return nullptr;
     return sprite.release();
@@ -224,7 +281,7 @@ Sprite *Sprite::AllocateWithBasicIscript(SpriteType sprite_id, const Point &pos,
 Sprite *LoneSpriteSystem::AllocateLone(SpriteType sprite_id, const Point &pos, int player)
 {
     ptr<Sprite> sprite(new Sprite);
-    SpriteIscriptContext ctx(sprite.get(), MainRng(), "LoneSpriteSystem::AllocateLone", false);
+    SpriteIscriptContext ctx(sprite.get(), sprite->IscriptRng(), "LoneSpriteSystem::AllocateLone", false);
     if (!sprite->Initialize(&ctx, sprite_id, pos, player))
         return nullptr;
 
@@ -235,7 +292,7 @@ Sprite *LoneSpriteSystem::AllocateLone(SpriteType sprite_id, const Point &pos, i
 Sprite *LoneSpriteSystem::AllocateFow(Sprite *base, UnitType unit_id)
 {
     ptr<Sprite> sprite_ptr(new Sprite);
-    SpriteIscriptContext ctx(sprite_ptr.get(), MainRng(), "LoneSpriteSystem::AllocateFow", false);
+    SpriteIscriptContext ctx(sprite_ptr.get(), sprite_ptr->IscriptRng(), "LoneSpriteSystem::AllocateFow", false);
     if (!sprite_ptr->Initialize(&ctx, base->Type(), base->position, base->player))
         return nullptr;
 
@@ -501,8 +558,7 @@ void UpdateDoodadVisibility(Sprite *sprite)
     // Orig func returns shit but not necessary now
 }
 
-/// Returns true if sprite should be deleted.
-static bool ProgressLoneSpriteFrame(Sprite *sprite)
+static void UpdateLoneSpriteVisibility(Sprite *sprite)
 {
     // Skip doodads
     if ((sprite->sprite_id > SpriteId::LastScDoodad.Raw() && sprite->sprite_id < SpriteId::FirstBwDoodad.Raw()) ||
@@ -512,8 +568,14 @@ static bool ProgressLoneSpriteFrame(Sprite *sprite)
     }
     else
         UpdateDoodadVisibility(sprite);
+}
+
+/// Returns true if sprite should be deleted.
+static bool ProgressLoneSpriteFrame(Sprite *sprite)
+{
+    UpdateLoneSpriteVisibility(sprite);
 
-    SpriteIscriptContext ctx(sprite, MainRng(), "ProgressLoneSpriteFrame", true);
+    SpriteIscriptContext ctx(sprite, sprite->IscriptRng(), "ProgressLoneSpriteFrame", true);
     ctx.ProgressIscript();
     return ctx.CheckDeleted();
 }
@@ -537,16 +599,59 @@ static bool ProgressFowSpriteFrame(Sprite *sprite)
     return false;
 }
 
+/// Like BulletSystem::ProgressWaitingIscripts, progresses the lone sprites whose iscript is
+/// only waiting in parallel, as that cannot delete them. The rest are left for ProgressFrames.
+void LoneSpriteSystem::ProgressWaitingIscripts()
+{
+    STATIC_PERF_CLOCK(LoneSpriteSystem_ProgressWaitingIscripts);
+    iscript_sprites.clear();
+    for (ptr<Sprite> &sprite : lone_sprites)
+        iscript_sprites.emplace_back(sprite.get());
+    waiting_done.resize(iscript_sprites.size());
+    std::atomic<uint32_t> done_sprites(0);
+    threads->ParallelFor(iscript_sprites.size(), 256, 4, [&](uint32_t begin, uint32_t end) {
+        uint32_t done = 0;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            waiting_done[i] = iscript_sprites[i]->ProgressWaitingImages();
+            done += waiting_done[i];
+        }
+        if (PerfTest)
+            done_sprites.fetch_add(done, std::memory_order_relaxed);
+    });
+    if (PerfTest)
+    {
+        perf_log->Log("Lone sprite iscripts: %u of %u only waiting\n",
+                done_sprites.load(std::memory_order_relaxed), (uint32_t)iscript_sprites.size());
+    }
+}
+
 void LoneSpriteSystem::ProgressFrames()
 {
-    for (auto entry : lone_sprites.Entries())
+    ProgressWaitingIscripts();
+    // Entries can't be swap_erased during this loop, as waiting_done has to stay in list
+    // order. Instead the positions of deleted sprites are kept, and erased from the last one
+    // so that the sprites swapped in from the end are never ones that are still to be erased.
+    // Sprites created during this loop get appended to the list and progressed as well,
+    // like they would otherwise.
+    uint32_t index = 0;
+    for (auto it = lone_sprites.begin(); it != lone_sprites.end(); ++it)
     {
-        if (ProgressLoneSpriteFrame(entry->get()) == true)
+        Sprite *sprite = it->get();
+        bool waiting = index < waiting_done.size() && waiting_done[index];
+        index++;
+        if (waiting)
+            UpdateLoneSpriteVisibility(sprite);
+        else if (ProgressLoneSpriteFrame(sprite) == true)
         {
-            entry->get()->Remove();
-            entry.swap_erase();
+            sprite->Remove();
+            removed_sprites.emplace_back(it);
         }
     }
+    for (auto it = removed_sprites.rbegin(); it != removed_sprites.rend(); ++it)
+        lone_sprites.swap_erase(*it);
+    removed_sprites.clear();
+
     for (auto entry : fow_sprites.Entries())
     {
         if (ProgressFowSpriteFrame(entry->get()) == true)
@@ -693,7 +798,7 @@ void DrawCursorMarker()
 
 void Sprite::SetIscriptAnimation_Lone(int anim, bool force, Rng *rng, const char *caller)
 {
-    SpriteIscriptContext(this, MainRng(), caller, false).SetIscriptAnimation(anim, force);
+    SpriteIscriptContext(this, rng, caller, false).SetIscriptAnimation(anim, force);
 }
 
 void ShowCursorMarker(uint16_t x, uint16_t y)
@@ -60,6 +60,12 @@ class Sprite
 
         uint32_t id; // 0x24
         uint32_t sort_order; // 0x28
+        /// Used for iscript of the sprite and its unit or bullet, see IscriptRng()
+        ObjectRng rng_stream; // 0x2c
+
+        /// Returns MainRng() unless object_rng_streams is enabled.
+        /// (Units and bullets have their own IscriptRng() which should be used instead)
+        Rng *IscriptRng() { return rng_stream.Get(ObjectRng::Sprite, id); }
 
         void Serialize(Save *save);
         static ptr<Sprite> Deserialize(Load *load);
@@ -116,10 +122,10 @@ class Sprite
         void RemoveSelectionOverlays();
         static int DrawnSprites() { return draw_order_amount; }
 
+        void operator delete(void *ptr);
+
     private:
-#ifdef SYNC
         void *operator new(size_t size);
-#endif
         Sprite();
 
         /// Initializes the sprite, returns false if unable and nothing was changed.
@@ -145,6 +151,20 @@ class Sprite
             }
         }
 
+        /// If every image is just waiting for its next command, decrements the waits and
+        /// returns true. Otherwise does nothing and returns false, and ProgressFrame has to be
+        /// called. Only touches the sprite's own images, so it can be used from any thread.
+        bool ProgressWaitingImages() {
+            for (Image *img : first_overlay) {
+                if (!img->IsOnlyWaiting())
+                    return false;
+            }
+            for (Image *img : first_overlay) {
+                img->iscript.wait -= 1;
+            }
+            return true;
+        }
+
         void SetIscriptAnimation(Iscript::Context *ctx, int anim, bool force) {
             if (!force && flags & SpriteFlags::Nobrkcodestart)
                 return;
@@ -192,6 +212,15 @@ class LoneSpriteSystem
 
         UnsortedList<ptr<Sprite>, 128> lone_sprites;
         UnsortedList<ptr<Sprite>> fow_sprites;
+
+    private:
+        void ProgressWaitingIscripts();
+
+        /// Used by ProgressFrames(), waiting_done is set by ProgressWaitingIscripts()
+        /// for each lone sprite in list order
+        vector<Sprite *> iscript_sprites;
+        vector<uint8_t> waiting_done;
+        vector<UnsortedList<ptr<Sprite>, 128>::iterator> removed_sprites;
 };
 
 extern LoneSpriteSystem *lone_sprites;
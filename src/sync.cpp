@@ -0,0 +1,276 @@
+#include "sync.h"
+
+#include <string.h>
+
+#include "console/assert.h"
+
+#include "log.h"
+#include "player.h"
+
+uint32_t HashSprite(const Sprite *sprite)
+{
+    uint32_t hash = sprite->sprite_id << 16 | sprite->player << 8 | sprite->visibility_mask;
+    hash ^= sprite->elevation;
+    hash ^= sprite->width << 24;
+    hash ^= sprite->height << 16;
+    hash ^= sprite->position.x << 8;
+    hash ^= sprite->position.y;
+    return hash;
+}
+
+static uint32_t HashPathValues(const Path *path)
+{
+    uint32_t hash = 0;
+    unsigned int pos = 0;
+    for (int i = 0; i < path->position_count && pos < sizeof path->values; i++, pos += 2)
+        hash ^= path->values[pos] | path->values[pos + 1] << 8;
+    for (int i = 0; i < path->unk1c && pos < sizeof path->values; i++, pos += 1)
+        hash ^= path->values[pos] << 16;
+    return hash;
+}
+
+uint32_t HashPathValues(Unit *unit)
+{
+    const Path *path = unit->path.get();
+    auto &priv = unit->sync_hash_private;
+    if (priv.hashed_path != path || priv.hashed_path_frame != path->start_frame)
+    {
+        priv.hashed_path = path;
+        priv.hashed_path_frame = path->start_frame;
+        priv.values_hash = HashPathValues(path);
+    }
+    else if (Debug || SyncTest)
+    {
+        uint32_t values_hash = HashPathValues(path);
+        if (values_hash != priv.values_hash)
+        {
+            debug_log->Log("Frame %x: Stale path values hash for unit %s: %08X, should be %08X\n",
+                    *bw::frame_count, unit->DebugStr().c_str(), priv.values_hash, values_hash);
+            priv.values_hash = values_hash;
+        }
+    }
+    return priv.values_hash;
+}
+
+SyncDumpWriter::SyncDumpWriter(const char *filename) : pending_frames(0), quit(false)
+{
+    CreateDirTree(filename);
+    file = fopen(filename, "wb");
+    if (file == nullptr)
+    {
+        debug_log->Log("Could not open sync dump %s\n", filename);
+        return;
+    }
+    SyncDump::FileHeader header = { SyncDump::FileMagic, SyncDump::Version };
+    fwrite(&header, sizeof header, 1, file);
+    thread = std::thread(&SyncDumpWriter::ThreadMain, this);
+}
+
+SyncDumpWriter::~SyncDumpWriter()
+{
+    if (file == nullptr)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    cv.notify_one();
+    thread.join();
+    fclose(file);
+}
+
+void SyncDumpWriter::ThreadMain()
+{
+    vector<vector<uint8_t>> writing;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (auto &buf : writing)
+                free_buffers.emplace_back(move(buf));
+            pending_frames -= writing.size();
+            if (!writing.empty())
+                written_cv.notify_one();
+            writing.clear();
+            cv.wait(lock, [this] { return quit || !queue.empty(); });
+            if (queue.empty())
+                return;
+            writing.swap(queue);
+        }
+        for (const auto &buf : writing)
+            fwrite(buf.data(), 1, buf.size(), file);
+    }
+}
+
+template <class Record>
+void SyncDumpWriter::Append(vector<uint8_t> *buf, const Record &record)
+{
+    const uint8_t *data = (const uint8_t *)&record;
+    buf->insert(buf->end(), data, data + sizeof(Record));
+}
+
+static uint32_t DumpId(const Unit *unit)
+{
+    return unit != nullptr ? unit->lookup_id : 0;
+}
+
+void SyncDumpWriter::DumpFrame()
+{
+    if (file == nullptr)
+        return;
+    vector<uint8_t> buf;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!free_buffers.empty())
+        {
+            buf = move(free_buffers.back());
+            free_buffers.pop_back();
+        }
+    }
+    buf.clear();
+
+    SyncDump::FrameHeader header;
+    memset(&header, 0, sizeof header);
+    header.magic = SyncDump::FrameMagic;
+    header.frame = *bw::frame_count;
+    header.rng_seed = *bw::rng_seed;
+    header.trigger_cycle_count = *bw::trigger_cycle_count;
+    header.countdown_timer = *bw::countdown_timer;
+    for (int i = 0; i < Limits::ActivePlayers; i++)
+        header.player_waits[i] = bw::player_waits[i];
+    // Header gets filled once the counts are known
+    Append(&buf, header);
+
+    units.clear();
+    for (Unit *unit : first_allocated_unit)
+    {
+        if (unit->sprite)
+            units.emplace_back(unit);
+    }
+    std::sort(units.begin(), units.end(), [](const Unit *a, const Unit *b) { return a->lookup_id < b->lookup_id; });
+    for (const Unit *unit : units)
+    {
+        SyncDump::Unit out;
+        const Sprite *sprite = unit->sprite.get();
+        out.lookup_id = unit->lookup_id;
+        out.target = DumpId(unit->target);
+        out.subunit = DumpId(unit->subunit);
+        out.previous_attacker = DumpId(unit->previous_attacker);
+        out.hp = unit->hitpoints;
+        out.shields = unit->shields;
+        out.current_speed = unit->current_speed;
+        out.next_speed = unit->next_speed;
+        out.flags = unit->flags;
+        out.x = sprite->position.x;
+        out.y = sprite->position.y;
+        out.move_target_x = unit->move_target.x;
+        out.move_target_y = unit->move_target.y;
+        out.order_target_x = unit->order_target_pos.x;
+        out.order_target_y = unit->order_target_pos.y;
+        out.energy = unit->energy;
+        out.ground_strength = unit->ground_strength;
+        out.air_strength = unit->air_strength;
+        out.sprite_id = sprite->sprite_id;
+        out.player = sprite->player;
+        out.visibility_mask = sprite->visibility_mask;
+        out.elevation = sprite->elevation;
+        out.width = sprite->width;
+        out.height = sprite->height;
+        out.invisibility_effects = unit->invisibility_effects;
+        out.facing_direction = unit->facing_direction;
+        out.movement_direction = unit->movement_direction;
+        out.target_direction = unit->target_direction;
+        out.order = unit->order;
+        out.secondary_order = unit->secondary_order;
+        out.movement_state = unit->movement_state;
+        out.flingy_flags = unit->flingy_flags;
+        out.move_target_update_timer = unit->move_target_update_timer;
+        Append(&buf, out);
+    }
+    header.unit_count = units.size();
+    for (const Unit *unit : units)
+    {
+        const Path *path = unit->path.get();
+        if (path == nullptr)
+            continue;
+        SyncDump::Path out;
+        out.lookup_id = unit->lookup_id;
+        out.start_x = path->start.x;
+        out.start_y = path->start.y;
+        out.next_x = path->next_pos.x;
+        out.next_y = path->next_pos.y;
+        out.end_x = path->end.x;
+        out.end_y = path->end.y;
+        out.flags = path->flags;
+        out.position_count = path->position_count;
+        out.position_index = path->position_index;
+        out.padding = 0;
+        Append(&buf, out);
+        header.path_count++;
+    }
+    for (const Bullet *bullet : bullet_system->ActiveBullets())
+    {
+        SyncDump::Bullet out;
+        memset(&out, 0, sizeof out);
+        out.parent = DumpId(bullet->parent);
+        out.weapon_id = bullet->weapon_id;
+        if (bullet->sprite)
+        {
+            const Sprite *sprite = bullet->sprite.get();
+            out.x = sprite->position.x;
+            out.y = sprite->position.y;
+            out.sprite_id = sprite->sprite_id;
+            out.player = sprite->player;
+            out.visibility_mask = sprite->visibility_mask;
+            out.elevation = sprite->elevation;
+            out.width = sprite->width;
+            out.height = sprite->height;
+        }
+        Append(&buf, out);
+        header.bullet_count++;
+    }
+    for (const Ai::Region *region : Ai::GetRegions())
+    {
+        SyncDump::AiRegion out;
+        out.region_id = region->region_id;
+        out.target_region_id = region->target_region_id;
+        out.flags = region->flags;
+        out.ground_unit_count = region->ground_unit_count;
+        out.needed_ground = region->needed_ground_strength;
+        out.needed_air = region->needed_air_strength;
+        out.enemy_air_strength = region->enemy_air_strength;
+        out.enemy_ground_strength = region->enemy_ground_strength;
+        out.player = region->player;
+        out.state = region->state;
+        Append(&buf, out);
+        header.ai_region_count++;
+    }
+    for (int i = 0; i < Limits::ActivePlayers; i++)
+    {
+        if (!IsComputerPlayer(i))
+            continue;
+        for (int j = 0; j < bw::player_ai[i].request_count; j++)
+        {
+            const auto &req = bw::player_ai[i].requests[j];
+            SyncDump::AiRequest out;
+            out.player = i;
+            out.priority = req.priority;
+            out.type = req.type;
+            out.padding = 0;
+            out.unit_id = req.unit_id;
+            out.index = j;
+            Append(&buf, out);
+            header.ai_request_count++;
+        }
+    }
+    header.size = buf.size() - sizeof header;
+    memcpy(buf.data(), &header, sizeof header);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        written_cv.wait(lock, [this] { return pending_frames < MaxPendingFrames; });
+        queue.emplace_back(move(buf));
+        pending_frames += 1;
+    }
+    cv.notify_one();
+}
@@ -7,8 +7,14 @@
 #include "pathing.h"
 #include "sprite.h"
 #include "ai.h"
+#include "log.h"
+#include "sync_dump.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
 
 /// Convenience class for writing sync dumps
 /// Writes spaces between data unless there was a newline
@@ -52,6 +58,47 @@ struct SyncHashes
     uint32_t trigger_hash;
 };
 
+uint32_t HashSprite(const Sprite *sprite);
+
+/// Hashes the values of unit's path, which are the expensive part of the paths hash.
+/// They only change when the unit gets a new path, so the result is cached until then.
+uint32_t HashPathValues(Unit *unit);
+
+/// Writes the binary state stream described in sync_dump.h.
+/// The game thread only copies the state into a buffer, formatting nothing, and a background
+/// thread writes the buffers to the file. Destroying the writer writes everything still queued.
+class SyncDumpWriter
+{
+    public:
+        SyncDumpWriter(const char *filename);
+        ~SyncDumpWriter();
+
+        bool IsOpen() const { return file != nullptr; }
+        /// Queues the state of the current frame. Waits for the writer thread if it has
+        /// fallen MaxPendingFrames behind, so a slow disk can't use unbounded memory.
+        void DumpFrame();
+
+    private:
+        static const uint32_t MaxPendingFrames = 64;
+
+        void ThreadMain();
+        template <class Record> void Append(vector<uint8_t> *buf, const Record &record);
+
+        FILE *file;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        /// Signaled when the writer has written frames
+        std::condition_variable written_cv;
+        vector<vector<uint8_t>> queue;
+        /// Frames queued or being written
+        uint32_t pending_frames;
+        /// Written buffers are given back to be reused
+        vector<vector<uint8_t>> free_buffers;
+        vector<const Unit *> units;
+        bool quit;
+};
+
 template <class W>
 inline void WriteValDiff(const Point &newer, const Point &older, W &Write, const char *desc)
 {
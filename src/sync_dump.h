@@ -0,0 +1,243 @@
+#ifndef SYNC_DUMP_H
+#define SYNC_DUMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Binary per-frame state stream written by sync test builds (dump\sync.bin), and read
+/// by tools/syncdiff.cpp. Kept free of any game headers so that the tool can include this.
+///
+/// The file begins with a FileHeader, followed by frames. Each frame is a FrameHeader
+/// followed by its records: units, paths, bullets, ai regions and ai requests, in that order,
+/// with counts given in the frame header. Units and paths are sorted by lookup id, everything
+/// else is in the order the game keeps them. All values are little-endian.
+namespace SyncDump {
+
+const uint32_t FileMagic = 0x31445354; // "TSD1"
+const uint32_t FrameMagic = 0x454d5246; // "FRME"
+const uint32_t Version = 1;
+
+#pragma pack(push)
+#pragma pack(1)
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct FrameHeader
+{
+    uint32_t magic;
+    uint32_t frame;
+    /// Bytes of records following the header
+    uint32_t size;
+    uint32_t rng_seed;
+    uint32_t trigger_cycle_count;
+    uint32_t countdown_timer;
+    uint32_t player_waits[8];
+    uint32_t unit_count;
+    uint32_t path_count;
+    uint32_t bullet_count;
+    uint32_t ai_region_count;
+    uint32_t ai_request_count;
+};
+
+/// Units are referred by their lookup id, 0 being no unit.
+struct Unit
+{
+    uint32_t lookup_id;
+    uint32_t target;
+    uint32_t subunit;
+    uint32_t previous_attacker;
+    int32_t hp;
+    uint32_t shields;
+    uint32_t current_speed;
+    uint32_t next_speed;
+    uint32_t flags;
+    uint16_t x;
+    uint16_t y;
+    uint16_t move_target_x;
+    uint16_t move_target_y;
+    uint16_t order_target_x;
+    uint16_t order_target_y;
+    uint16_t energy;
+    uint16_t ground_strength;
+    uint16_t air_strength;
+    uint16_t sprite_id;
+    uint8_t player;
+    uint8_t visibility_mask;
+    uint8_t elevation;
+    uint8_t width;
+    uint8_t height;
+    uint8_t invisibility_effects;
+    uint8_t facing_direction;
+    uint8_t movement_direction;
+    uint8_t target_direction;
+    uint8_t order;
+    uint8_t secondary_order;
+    uint8_t movement_state;
+    uint8_t flingy_flags;
+    uint8_t move_target_update_timer;
+};
+
+struct Path
+{
+    uint32_t lookup_id;
+    uint16_t start_x;
+    uint16_t start_y;
+    uint16_t next_x;
+    uint16_t next_y;
+    uint16_t end_x;
+    uint16_t end_y;
+    uint8_t flags;
+    uint8_t position_count;
+    uint8_t position_index;
+    uint8_t padding;
+};
+
+struct Bullet
+{
+    uint32_t parent;
+    uint16_t x;
+    uint16_t y;
+    uint16_t sprite_id;
+    uint8_t player;
+    uint8_t visibility_mask;
+    uint8_t elevation;
+    uint8_t width;
+    uint8_t height;
+    uint8_t weapon_id;
+};
+
+struct AiRegion
+{
+    uint16_t region_id;
+    uint16_t target_region_id;
+    uint16_t flags;
+    uint16_t ground_unit_count;
+    uint16_t needed_ground;
+    uint16_t needed_air;
+    uint16_t enemy_air_strength;
+    uint16_t enemy_ground_strength;
+    uint8_t player;
+    uint8_t state;
+};
+
+struct AiRequest
+{
+    uint8_t player;
+    uint8_t priority;
+    uint8_t type;
+    uint8_t padding;
+    uint16_t unit_id;
+    uint16_t index;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(FrameHeader) == 0x4c, "sizeof(SyncDump::FrameHeader)");
+static_assert(sizeof(Unit) == 0x46, "sizeof(SyncDump::Unit)");
+static_assert(sizeof(Path) == 0x14, "sizeof(SyncDump::Path)");
+static_assert(sizeof(Bullet) == 0x10, "sizeof(SyncDump::Bullet)");
+static_assert(sizeof(AiRegion) == 0x12, "sizeof(SyncDump::AiRegion)");
+static_assert(sizeof(AiRequest) == 0x8, "sizeof(SyncDump::AiRequest)");
+
+/// Describes record fields so that the diff tool can name the field that differs.
+struct Field
+{
+    const char *name;
+    uint16_t offset;
+    uint8_t size;
+};
+
+#define SYNC_DUMP_FIELD(type, name) { #name, offsetof(type, name), sizeof(((type *)0)->name) }
+
+const Field unit_fields[] = {
+    SYNC_DUMP_FIELD(Unit, lookup_id),
+    SYNC_DUMP_FIELD(Unit, target),
+    SYNC_DUMP_FIELD(Unit, subunit),
+    SYNC_DUMP_FIELD(Unit, previous_attacker),
+    SYNC_DUMP_FIELD(Unit, hp),
+    SYNC_DUMP_FIELD(Unit, shields),
+    SYNC_DUMP_FIELD(Unit, current_speed),
+    SYNC_DUMP_FIELD(Unit, next_speed),
+    SYNC_DUMP_FIELD(Unit, flags),
+    SYNC_DUMP_FIELD(Unit, x),
+    SYNC_DUMP_FIELD(Unit, y),
+    SYNC_DUMP_FIELD(Unit, move_target_x),
+    SYNC_DUMP_FIELD(Unit, move_target_y),
+    SYNC_DUMP_FIELD(Unit, order_target_x),
+    SYNC_DUMP_FIELD(Unit, order_target_y),
+    SYNC_DUMP_FIELD(Unit, energy),
+    SYNC_DUMP_FIELD(Unit, ground_strength),
+    SYNC_DUMP_FIELD(Unit, air_strength),
+    SYNC_DUMP_FIELD(Unit, sprite_id),
+    SYNC_DUMP_FIELD(Unit, player),
+    SYNC_DUMP_FIELD(Unit, visibility_mask),
+    SYNC_DUMP_FIELD(Unit, elevation),
+    SYNC_DUMP_FIELD(Unit, width),
+    SYNC_DUMP_FIELD(Unit, height),
+    SYNC_DUMP_FIELD(Unit, invisibility_effects),
+    SYNC_DUMP_FIELD(Unit, facing_direction),
+    SYNC_DUMP_FIELD(Unit, movement_direction),
+    SYNC_DUMP_FIELD(Unit, target_direction),
+    SYNC_DUMP_FIELD(Unit, order),
+    SYNC_DUMP_FIELD(Unit, secondary_order),
+    SYNC_DUMP_FIELD(Unit, movement_state),
+    SYNC_DUMP_FIELD(Unit, flingy_flags),
+    SYNC_DUMP_FIELD(Unit, move_target_update_timer),
+};
+
+const Field path_fields[] = {
+    SYNC_DUMP_FIELD(Path, lookup_id),
+    SYNC_DUMP_FIELD(Path, start_x),
+    SYNC_DUMP_FIELD(Path, start_y),
+    SYNC_DUMP_FIELD(Path, next_x),
+    SYNC_DUMP_FIELD(Path, next_y),
+    SYNC_DUMP_FIELD(Path, end_x),
+    SYNC_DUMP_FIELD(Path, end_y),
+    SYNC_DUMP_FIELD(Path, flags),
+    SYNC_DUMP_FIELD(Path, position_count),
+    SYNC_DUMP_FIELD(Path, position_index),
+};
+
+const Field bullet_fields[] = {
+    SYNC_DUMP_FIELD(Bullet, parent),
+    SYNC_DUMP_FIELD(Bullet, x),
+    SYNC_DUMP_FIELD(Bullet, y),
+    SYNC_DUMP_FIELD(Bullet, sprite_id),
+    SYNC_DUMP_FIELD(Bullet, player),
+    SYNC_DUMP_FIELD(Bullet, visibility_mask),
+    SYNC_DUMP_FIELD(Bullet, elevation),
+    SYNC_DUMP_FIELD(Bullet, width),
+    SYNC_DUMP_FIELD(Bullet, height),
+    SYNC_DUMP_FIELD(Bullet, weapon_id),
+};
+
+const Field ai_region_fields[] = {
+    SYNC_DUMP_FIELD(AiRegion, region_id),
+    SYNC_DUMP_FIELD(AiRegion, target_region_id),
+    SYNC_DUMP_FIELD(AiRegion, flags),
+    SYNC_DUMP_FIELD(AiRegion, ground_unit_count),
+    SYNC_DUMP_FIELD(AiRegion, needed_ground),
+    SYNC_DUMP_FIELD(AiRegion, needed_air),
+    SYNC_DUMP_FIELD(AiRegion, enemy_air_strength),
+    SYNC_DUMP_FIELD(AiRegion, enemy_ground_strength),
+    SYNC_DUMP_FIELD(AiRegion, player),
+    SYNC_DUMP_FIELD(AiRegion, state),
+};
+
+const Field ai_request_fields[] = {
+    SYNC_DUMP_FIELD(AiRequest, player),
+    SYNC_DUMP_FIELD(AiRequest, priority),
+    SYNC_DUMP_FIELD(AiRequest, type),
+    SYNC_DUMP_FIELD(AiRequest, unit_id),
+    SYNC_DUMP_FIELD(AiRequest, index),
+};
+
+#undef SYNC_DUMP_FIELD
+
+} // namespace SyncDump
+
+#endif /* SYNC_DUMP_H */
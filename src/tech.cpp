@@ -100,6 +100,11 @@ void Maelstrom(Unit *attacker, const Point &position)
     });
 }
 
+// Reused buffers for UpdateDwebStatuses
+static vector<Rect16> dweb_areas;
+static vector<Unit *> dweb_units;
+static vector<uint32_t> dweb_unit_offsets;
+
 void UpdateDwebStatuses()
 {
     for (Unit *unit = *bw::first_active_unit; unit; unit = unit->next())
@@ -116,6 +121,7 @@ void UpdateDwebStatuses()
     }
     if (score->CompletedUnits(UnitId::DisruptionWeb, NeutralPlayer) != 0)
     {
+        dweb_areas.clear();
         for (Unit *dweb : bw::first_player_unit[NeutralPlayer])
         {
             if (dweb->unit_id != UnitId::DisruptionWeb)
@@ -127,19 +133,22 @@ void UpdateDwebStatuses()
             area.top = dweb->sprite->position.y - dweb_dbox.top;
             area.right = dweb->sprite->position.x + dweb_dbox.right;
             area.bottom = dweb->sprite->position.y + dweb_dbox.bottom;
-            unit_search->ForEachUnitInArea(area, [](Unit *unit) {
-                if (!unit->IsFlying())
+            dweb_areas.push_back(area);
+        }
+        // Units under several webs are included once for each of them
+        unit_search->FindUnitsRects(dweb_areas, &dweb_units, &dweb_unit_offsets);
+        for (Unit *unit : dweb_units)
+        {
+            if (!unit->IsFlying())
+            {
+                unit->flags |= UnitStatus::UnderDweb;
+                if (unit->subunit != nullptr)
+                    unit->subunit->flags |= UnitStatus::UnderDweb;
+                for (Unit *child = unit->first_loaded; child; child = child->next_loaded)
                 {
-                    unit->flags |= UnitStatus::UnderDweb;
-                    if (unit->subunit != nullptr)
-                        unit->subunit->flags |= UnitStatus::UnderDweb;
-                    for (Unit *child = unit->first_loaded; child; child = child->next_loaded)
-                    {
-                        child->flags |= UnitStatus::UnderDweb;
-                    }
+                    child->flags |= UnitStatus::UnderDweb;
                 }
-                return false;
-            });
+            }
         }
     }
 }
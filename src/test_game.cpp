@@ -9,6 +9,7 @@
 
 #include "constants/image.h"
 #include "constants/order.h"
+#include "constants/sprite.h"
 #include "constants/tech.h"
 #include "constants/upgrade.h"
 #include "constants/unit.h"
@@ -22,6 +23,7 @@
 #include "offsets.h"
 #include "order.h"
 #include "player.h"
+#include "replay.h"
 #include "selection.h"
 #include "sound.h"
 #include "targeting.h"
@@ -2220,6 +2222,80 @@ struct Test_PathingFlingyGap : public GameTest {
     }
 };
 
+/// Checks that the native region search finds connected regions, that
+/// searches for the same regions during a frame share the result, and that
+/// the flow fields used for popular goals produce valid paths as well.
+struct Test_RegionPath : public GameTest {
+    void Init() override {
+    }
+    void NextFrame() override {
+        Point start(0x100, 0x100);
+        Point end(*bw::map_width - 0x100, *bw::map_height - 0x100);
+        int start_region = Pathing::GetRegion(start);
+        int end_region = Pathing::GetRegion(end);
+        auto check_path = [&](const std::vector<uint16_t> *regions, int start_region) {
+            TestAssert(regions != nullptr);
+            TestAssert(regions->front() == start_region && regions->back() == end_region);
+            for (unsigned i = 1; i < regions->size(); i++) {
+                const auto &region = GetPathingSystem()->regions[(*regions)[i - 1]];
+                auto neighbours_end = region.neighbour_ids + region.group_neighbour_count;
+                TestAssert(std::find(region.neighbour_ids, neighbours_end, (*regions)[i]) != neighbours_end);
+            }
+        };
+        const auto *regions = Pathing::FindRegionPath(start_region, end_region);
+        check_path(regions, start_region);
+        TestAssert(Pathing::FindRegionPath(start_region, end_region) == regions);
+        // Searching from many regions to the same goal switches to a flow field
+        auto group = GetPathingSystem()->regions[end_region].group;
+        for (int i = 0; i < GetPathingSystem()->region_count; i++) {
+            if (GetPathingSystem()->regions[i].group == group)
+                check_path(Pathing::FindRegionPath(i, end_region), i);
+        }
+
+        Unit *probe = CreateUnitForTestAt(UnitId::Probe, 0, start);
+        TestAssert(CreateRegionPath(probe, end));
+        TestAssert(probe->path->start == start && probe->path->end == end);
+        TestAssert(probe->path->position_count != 0);
+        if (regions->size() <= 2)
+            TestAssert(probe->path->next_pos == end);
+        Pass();
+    }
+};
+
+/// Moves a unit with region_path_movement enabled, which has the movement use
+/// CreateRegionPath instead of bw's MakePath.
+struct Test_RegionPathMovement : public GameTest {
+    Unit *unit;
+    bool was_enabled;
+    Point target;
+    void Init() override {
+        was_enabled = region_path_movement;
+        region_path_movement = true;
+    }
+    void Done() override {
+        region_path_movement = was_enabled;
+    }
+    void NextFrame() override {
+        switch (state) {
+            case 0: {
+                unit = CreateUnitForTestAt(UnitId::Marine, 0, Point(100, 100));
+                target = Point(600, 300);
+                unit->IssueOrderTargetingGround(OrderId::Move, target);
+                state++;
+            } break; case 1: {
+                if (unit->path) {
+                    TestAssert(unit->path->end == target);
+                    state++;
+                }
+            } break; case 2: {
+                if (unit->sprite->position == target) {
+                    Pass();
+                }
+            }
+        }
+    }
+};
+
 struct Test_RallyPoint : public GameTest {
     Unit *unit;
     Point old_rally;
@@ -3401,6 +3477,170 @@ struct Test_AiRepair : public GameTest {
     }
 };
 
+static int LinkedSpriteCount() {
+    int count = 0;
+    for (int i = 0; i < *bw::map_height_tiles; i++) {
+        for (Sprite *sprite = bw::horizontal_sprite_lines[i]; sprite != nullptr; sprite = sprite->list.next) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/// Spawns lone sprites a wave per frame, so that some sprites are only waiting, some run
+/// their iscript and some get deleted on the same frames, in more than one list chunk.
+/// Then creates fow sprites of a visible building, which get deleted once the vision updates.
+/// Deleted sprites have to be unlinked from the horizontal sprite lines and erased from the lists.
+struct Test_LoneSpriteExpiry : public GameTest {
+    uintptr_t lone_count;
+    uintptr_t fow_count;
+    int linked_count;
+    int waves;
+    Unit *building;
+    void Init() override {
+        waves = 0;
+    }
+    void NextFrame() override {
+        switch (state) {
+            case 0: {
+                lone_count = lone_sprites->lone_sprites.size();
+                fow_count = lone_sprites->fow_sprites.size();
+                linked_count = LinkedSpriteCount();
+                state++;
+            } break; case 1: {
+                for (int i = 0; i < 100; i++) {
+                    Point pos(100 + (i % 10) * 40, 100 + (i / 10) * 40);
+                    TestAssert(lone_sprites->AllocateLone(SpriteId::FlameThrower, pos, 0) != nullptr);
+                }
+                waves++;
+                TestAssert(lone_sprites->lone_sprites.size() > lone_count);
+                if (waves == 5)
+                    state++;
+            } break; case 2: {
+                if (lone_sprites->lone_sprites.size() == lone_count) {
+                    TestAssert(LinkedSpriteCount() == linked_count);
+                    building = CreateUnitForTestAt(UnitId::CommandCenter, 0, Point(300, 300));
+                    linked_count = LinkedSpriteCount();
+                    state++;
+                }
+            } break; case 3: {
+                for (int i = 0; i < 10; i++) {
+                    TestAssert(lone_sprites->AllocateFow(building->sprite.get(), building->Type()) != nullptr);
+                }
+                TestAssert(lone_sprites->fow_sprites.size() == fow_count + 10);
+                TestAssert(LinkedSpriteCount() == linked_count + 10);
+                state++;
+            } break; case 4: {
+                if (lone_sprites->fow_sprites.size() == fow_count) {
+                    TestAssert(LinkedSpriteCount() == linked_count);
+                    Pass();
+                }
+            }
+        }
+    }
+};
+
+/// Moves a stack of flyers with batch_flyer_movement enabled and then disabled, starting
+/// from the same state, and checks that the positions match on every frame.
+/// Bw has no flying units with turrets, so a siege tank is made to use flyer movement as well,
+/// which has its turret, a subunit, progressed between the batched flyers.
+struct Test_FlyerBatch : public GameTest {
+    static const int Frames = 100;
+    static const int StackSize = 12;
+    bool was_enabled;
+    uint32_t rng_seed;
+    int frame;
+    vector<Unit *> units;
+    vector<Point> positions[2];
+    void Init() override {
+        was_enabled = batch_flyer_movement;
+    }
+    void Done() override {
+        batch_flyer_movement = was_enabled;
+    }
+    void CreateUnits() {
+        units.clear();
+        const UnitType flyers[] = { UnitId::Mutalisk, UnitId::Wraith, UnitId::Scout, UnitId::Overlord };
+        for (int i = 0; i < StackSize; i++) {
+            Unit *unit = CreateUnitForTestAt(flyers[i % 4], 0, Point(200 + i % 3, 200 + i / 3));
+            unit->IssueOrderTargetingGround(OrderId::Move, Point(700, 400 + (i % 2) * 100));
+            units.push_back(unit);
+        }
+        Unit *tank = CreateUnitForTestAt(UnitId::SiegeTankTankMode, 0, Point(250, 250));
+        tank->IssueOrderTargetingGround(OrderId::Move, Point(700, 450));
+        units.push_back(tank);
+    }
+    void NextFrame() override {
+        switch (state) {
+            case 0: case 2: {
+                bool batched = state == 0;
+                batch_flyer_movement = batched;
+                if (batched)
+                    rng_seed = *bw::rng_seed;
+                else
+                    *bw::rng_seed = rng_seed;
+                CreateUnits();
+                frame = 0;
+                state++;
+            } break; case 1: case 3: {
+                auto &pos = positions[state == 1 ? 0 : 1];
+                Unit *tank = units.back();
+                tank->movement_state = MovementState::Flyer;
+                for (Unit *unit : units) {
+                    pos.push_back(unit->sprite->position);
+                }
+                pos.push_back(tank->subunit->sprite->position);
+                frame++;
+                if (frame == Frames) {
+                    ClearUnits();
+                    state++;
+                }
+            } break; case 4: {
+                TestAssert(positions[0].size() == positions[1].size());
+                for (unsigned i = 0; i < positions[0].size(); i++) {
+                    TestAssert(positions[0][i] == positions[1][i]);
+                }
+                // Verify that the units moved, so the comparison is not trivial
+                TestAssert(positions[0][0] != positions[0][positions[0].size() - StackSize - 2]);
+                Pass();
+            }
+        }
+    }
+};
+
+/// The replay command index reports a command stream with frames out of order
+/// once the last frame before the bogus one has been played.
+struct Test_ReplayFrameOrder : public GameTest {
+    void Init() override {
+    }
+    static void AddKeepAlive(std::vector<uint8_t> *buf, uint32_t frame) {
+        const uint8_t cmd[] = { 2, 0, commands::KeepAlive };
+        buf->insert(buf->end(), (const uint8_t *)&frame, (const uint8_t *)&frame + 4);
+        buf->insert(buf->end(), cmd, cmd + sizeof cmd);
+    }
+    void NextFrame() override {
+        std::vector<uint8_t> buf;
+        AddKeepAlive(&buf, 10);
+        AddKeepAlive(&buf, 20);
+        AddKeepAlive(&buf, 30);
+        ReplayData replay_data;
+        memset(&replay_data, 0, sizeof(ReplayData));
+        replay_data.beg = buf.data();
+        replay_data.length_bytes = buf.size();
+        TestAssert(FindReplayCorruption(&replay_data) == UINT32_MAX);
+
+        buf.clear();
+        AddKeepAlive(&buf, 10);
+        AddKeepAlive(&buf, 20);
+        AddKeepAlive(&buf, 15);
+        AddKeepAlive(&buf, 30);
+        replay_data.beg = buf.data();
+        replay_data.length_bytes = buf.size();
+        TestAssert(FindReplayCorruption(&replay_data) == 20);
+        Pass();
+    }
+};
+
 GameTests::GameTests()
 {
     current_test = -1;
@@ -3443,6 +3683,8 @@ GameTests::GameTests()
     AddTest("Transmission trigger", new Test_Transmission);
     AddTest("Nearby helpers", new Test_NearbyHelpers);
     AddTest("Pathing small gap w/ flingy movement", new Test_PathingFlingyGap);
+    AddTest("Region path", new Test_RegionPath);
+    AddTest("Region path movement", new Test_RegionPathMovement);
     AddTest("Rally point", new Test_RallyPoint);
     AddTest("Morph extractor", new Test_Extractor);
     AddTest("Critter explosion", new Test_CritterExplosion);
@@ -3460,6 +3702,9 @@ GameTests::GameTests()
     AddTest("Damage overlays", new Test_DamageOverlays);
     AddTest("Ai bunker strength", new Test_AiBunkerStrength);
     AddTest("Ai repair", new Test_AiRepair);
+    AddTest("Replay frame order", new Test_ReplayFrameOrder);
+    AddTest("Lone sprite expiry", new Test_LoneSpriteExpiry);
+    AddTest("Flyer movement batch", new Test_FlyerBatch);
 }
 
 void GameTests::AddTest(const char *name, GameTest *test)
@@ -1,6 +1,8 @@
 #ifndef THREAD_H
 #define THREAD_H
 
+#include <algorithm>
+#include <atomic>
 #include <queue>
 #include <vector>
 #include <thread>
@@ -131,6 +133,40 @@ class PoolThread : public Thread<Tvar>
         PoolThread *next_free;
 };
 
+/// Chunks of ThreadPool::ParallelFor, which the threads take in order until there are none left
+template <typename Func>
+struct ParallelForJob
+{
+    ParallelForJob(uint32_t count, uint32_t chunk_size, Func *func) : func(func), count(count),
+        chunk_size(chunk_size), chunk_count((count + chunk_size - 1) / chunk_size), next_chunk(0),
+        finished_threads(0) { }
+
+    void Run()
+    {
+        while (true)
+        {
+            uint32_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunk_count)
+                return;
+            (*func)(chunk * chunk_size, std::min((chunk + 1) * chunk_size, count));
+        }
+    }
+
+    template <typename Tvar>
+    static void Threaded(Tvar *tvars, ParallelForJob *job)
+    {
+        job->Run();
+        job->finished_threads.fetch_add(1, std::memory_order_release);
+    }
+
+    Func * const func;
+    const uint32_t count;
+    const uint32_t chunk_size;
+    const uint32_t chunk_count;
+    std::atomic<uint32_t> next_chunk;
+    std::atomic<uint32_t> finished_threads;
+};
+
 template <typename Tvar>
 class ThreadPool
 {
@@ -246,6 +282,29 @@ class ThreadPool
             }
         }
 
+        /// Calls func(begin, end) for chunks of [0, count), using both the calling thread and
+        /// the workers. Returns once every chunk is done, so func may refer to the caller's stack.
+        /// If there are less than min_chunks chunks, they are all run on the calling thread, as
+        /// waking the workers would cost more than it saves. Has the same single caller
+        /// limitation as AddTask.
+        template <typename Func>
+        void ParallelFor(uint32_t count, uint32_t chunk_size, uint32_t min_chunks, Func func)
+        {
+            ParallelForJob<Func> job(count, chunk_size, &func);
+            if (job.chunk_count < min_chunks || job.chunk_count < 2)
+            {
+                job.Run();
+                return;
+            }
+            uint32_t thread_count = std::min((uint32_t)threads.size(), job.chunk_count - 1);
+            for (uint32_t i = 0; i < thread_count; i++)
+                AddTask(&ParallelForJob<Func>::template Threaded<Tvar>, &job);
+            job.Run();
+            // Even if this thread ended up doing all of the work
+            while (job.finished_threads.load(std::memory_order_acquire) != thread_count)
+                SwitchToThread();
+        }
+
         template <typename Func>
         void ForEachThread(Func func)
         {
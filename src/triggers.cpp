@@ -6,6 +6,7 @@
 #include "player.h"
 #include "resolution.h"
 #include "unit.h"
+#include "unitsearch.h"
 
 #include <string.h>
 #include <algorithm>
@@ -36,6 +37,25 @@ struct ChangeInvincibilityParam
 };
 #pragma pack(pop)
 
+static int (__fastcall *orig_give_units)(TriggerAction *);
+
+// Bw gives the units without going through Unit::GiveTo
+static int __fastcall TrigAction_GiveUnits(TriggerAction *action)
+{
+    int result = orig_give_units(action);
+    unit_search->UpdateAllUnitOwners();
+    return result;
+}
+
+void HookTriggerActions()
+{
+    // Wrapping twice would make the wrapper call itself
+    if (bw::trigger_actions[0x30] == &TrigAction_GiveUnits)
+        return;
+    orig_give_units = bw::trigger_actions[0x30];
+    bw::trigger_actions[0x30] = &TrigAction_GiveUnits;
+}
+
 void ProgressTriggers()
 {
     if (*bw::dont_progress_frame && !*bw::trigger_pause)
@@ -69,5 +69,7 @@ int Trig_KillUnitGeneric(Unit *unit, KillUnitArgs *args, bool check_height, bool
 
 int __fastcall TrigAction_Transmission(TriggerAction *action);
 int __fastcall TrigAction_CenterView(TriggerAction *action);
+/// Wraps bw's Give Units action, so has to be called after the actions have been replaced
+void HookTriggerActions();
 
 #endif // TRIGGERS_H
@@ -54,6 +54,9 @@ vector<Unit *> Unit::temp_flagged;
 Unit *Unit::id_lookup[UNIT_ID_LOOKUP_SIZE];
 
 bool late_unit_frames_in_progress = false;
+CombatStatsCounters combat_stats_counters;
+/// Compared against Unit::CombatStatsPrivate::generation, increased every frame
+static uint32_t combat_stats_generation = 0;
 
 #ifdef SYNC
 void *Unit::operator new(size_t size)
@@ -444,6 +447,7 @@ void Unit::ProgressOrder_Hidden(ProgressUnitResults *results)
         break;
         case OrderId::RescuePassive:
             bw::Order_RescuePassive(this);
+            unit_search->UpdateUnitOwner(this);
         break;
     }
 }
@@ -1085,6 +1089,7 @@ ProgressUnitResults Unit::ProgressFrames()
         unit->ProgressActiveUnitFrame<false>(); // This does movement as well
     }
     // Flyer optimization as their movement is slow when there's large stack of them
+    Unit::PrepareFlyerMovement();
     for (Unit *unit : first_movementstate_flyer)
     {
         *bw::active_iscript_unit = unit;
@@ -1150,6 +1155,7 @@ ProgressUnitResults Unit::ProgressFrames()
     unit_search->EnableAreaCache();
     late_unit_frames_in_progress = true;
     enemy_unit_cache->Clear();
+    UpdateCombatStats();
     for (Unit *next = *bw::first_active_unit; next;)
     {
         Unit *unit = next;
@@ -1186,6 +1192,12 @@ ProgressUnitResults Unit::ProgressFrames()
     perf_log->Log("ProgressUnitFrames: Pre %f ms + Movement %f ms + Misc %f ms + Active main %f ms + post %f ms = about %f ms\n",
                  pre_time, movement_time, misc_time, active_frames_time, post_time, klokki.GetTime());
     perf_log->Indent(2);
+    const auto &resort = unit_search->LastResort();
+    if (resort.method != MainUnitSearch::ResortMethod::None)
+    {
+        perf_log->Log("Flyer re-sort: %s, %u of %u units moved\n", MainUnitSearch::ResortMethodName(resort.method),
+                resort.moved, resort.span);
+    }
     StaticPerfClock::LogCalls();
     perf_log->Indent(-2);
     return results;
@@ -1274,7 +1286,7 @@ bool Unit::IsOnYellowHealth() const
     return percentage < 66 && percentage > 33;
 }
 
-int Unit::GetWeaponRange(bool ground) const
+int Unit::CalculateWeaponRange(bool ground) const
 {
     using namespace UnitId;
 
@@ -1284,8 +1296,6 @@ int Unit::GetWeaponRange(bool ground) const
     else
         range = GetTurret()->GetAirWeapon().MaxRange();
 
-    if (flags & UnitStatus::InBuilding)
-        range += 0x40;
     switch (unit_id)
     {
         case Marine:
@@ -1315,6 +1325,28 @@ int Unit::GetWeaponRange(bool ground) const
     }
 }
 
+int Unit::GetWeaponRange(bool ground) const
+{
+    int range;
+    const CombatStatsPrivate *stats = CombatStats();
+    if (stats != nullptr)
+        range = stats->weapon_range[ground];
+    else
+        range = CalculateWeaponRange(ground);
+    if (flags & UnitStatus::InBuilding)
+        range += 0x40;
+    return range;
+}
+
+int Unit::CalculateSightRange() const
+{
+    auto upgrade = Type().SightUpgrade();
+    if (upgrade != UpgradeId::None && GetUpgradeLevel(upgrade, player) != 0)
+        return 11;
+    else
+        return Type().SightRange();
+}
+
 int Unit::GetSightRange(bool dont_check_blind) const
 {
     if (flags & UnitStatus::Building && ~flags & UnitStatus::Completed && !IsMorphingBuilding())
@@ -1323,30 +1355,19 @@ int Unit::GetSightRange(bool dont_check_blind) const
     if (!dont_check_blind && blind)
         return 2;
 
-    auto upgrade = Type().SightUpgrade();
-    if (upgrade != UpgradeId::None && GetUpgradeLevel(upgrade, player) != 0)
-        return 11;
-    else
-        return Type().SightRange();
+    const CombatStatsPrivate *stats = CombatStats();
+    if (stats != nullptr)
+        return stats->sight_range;
+    return CalculateSightRange();
 }
 
-int Unit::GetTargetAcquisitionRange() const
+int Unit::CalculateTargetAcquisitionRange() const
 {
     using namespace UnitId;
 
     int base_range = Type().TargetAcquisitionRange();
     switch (unit_id)
     {
-        case Ghost:
-        case AlexeiStukov:
-        case SamirDuran:
-        case SarahKerrigan:
-        case InfestedDuran:
-            if (IsInvisible() && OrderType() == OrderId::HoldPosition)
-                return 0;
-            else
-                return base_range;
-        break;
         case Marine:
             return base_range + GetUpgradeLevel(UpgradeId::U_238Shells, player);
         break;
@@ -1381,6 +1402,69 @@ int Unit::GetTargetAcquisitionRange() const
     }
 }
 
+int Unit::GetTargetAcquisitionRange() const
+{
+    using namespace UnitId;
+
+    switch (unit_id)
+    {
+        case Ghost:
+        case AlexeiStukov:
+        case SamirDuran:
+        case SarahKerrigan:
+        case InfestedDuran:
+            if (IsInvisible() && OrderType() == OrderId::HoldPosition)
+                return 0;
+        break;
+        default:
+        break;
+    }
+    const CombatStatsPrivate *stats = CombatStats();
+    if (stats != nullptr)
+        return stats->acquisition_range;
+    return CalculateTargetAcquisitionRange();
+}
+
+const Unit::CombatStatsPrivate *Unit::CombatStats() const
+{
+    if (!late_unit_frames_in_progress && !bulletframes_in_progress)
+        return nullptr;
+    const CombatStatsPrivate &stats = combat_stats_private;
+    if (stats.generation == combat_stats_generation && stats.unit_id == unit_id && stats.player == player)
+    {
+        if (PerfTest)
+            combat_stats_counters.hits.fetch_add(1, std::memory_order_relaxed);
+        return &stats;
+    }
+    if (PerfTest)
+        combat_stats_counters.misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void Unit::UpdateCombatStats()
+{
+    combat_stats_generation += 1;
+    if (combat_stats_generation == 0)
+        combat_stats_generation = 1;
+    for (Unit *unit : *bw::first_active_unit)
+    {
+        const Unit *turret = unit->GetTurret();
+        // Lurker's ground weapon depends on it being burrowed, so it is calculated every time
+        if (turret->Type() == UnitId::Lurker)
+            continue;
+        CombatStatsPrivate &stats = unit->combat_stats_private;
+        stats.generation = combat_stats_generation;
+        stats.unit_id = unit->unit_id;
+        stats.player = unit->player;
+        stats.air_weapon = turret->GetAirWeapon().Raw();
+        stats.ground_weapon = turret->GetGroundWeapon().Raw();
+        stats.weapon_range[0] = unit->CalculateWeaponRange(false);
+        stats.weapon_range[1] = unit->CalculateWeaponRange(true);
+        stats.acquisition_range = unit->CalculateTargetAcquisitionRange();
+        stats.sight_range = unit->CalculateSightRange();
+    }
+}
+
 void Unit::IncrementKills()
 {
     if (kills != 0xffff)
@@ -2286,6 +2370,15 @@ bool Unit::CanAttackUnit(const Unit *enemy, bool check_detection) const
         break;
     }
 
+    const CombatStatsPrivate *stats = CombatStats();
+    if (stats != nullptr)
+    {
+        if (enemy->IsFlying())
+            return stats->air_weapon != WeaponId::None;
+        else
+            return stats->ground_weapon != WeaponId::None;
+    }
+
     const Unit *turret = GetTurret();
 
     if (enemy->IsFlying())
@@ -3055,7 +3148,7 @@ void Unit::ShowShieldHitOverlay(int direction)
     direction = ((direction - 0x7c) >> 3) & 0x1f;
     int8_t *shield_los = img->Type().ShieldOverlay();
     shield_los = shield_los + *(uint32_t *)(shield_los + 8 + img->direction * 4) + direction * 2; // sigh
-    UnitIscriptContext ctx(this, nullptr, "ShowShieldHitOverlay", MainRng(), false);
+    UnitIscriptContext ctx(this, nullptr, "ShowShieldHitOverlay", IscriptRng(), false);
     sprite->AddOverlayAboveMain(&ctx, ImageId::ShieldOverlay, shield_los[0], shield_los[1], direction);
 }
 
@@ -4550,6 +4643,7 @@ void Unit::GiveTo(int new_player, ProgressUnitResults *results)
     if (Type().HasHangar())
         CancelTrain(results);
     bw::GiveUnit(this, new_player, 1);
+    unit_search->UpdateUnitOwner(this);
     if (IsActivePlayer(new_player))
         bw::GiveSprite(this, new_player);
     if (IsBuildingAddon() || ~flags & UnitStatus::Completed || Type().Flags() & UnitFlags::SingleEntity)
@@ -4777,19 +4871,24 @@ void Unit::WarnUnhandledIscriptCommand(const Iscript::Command &cmd, const char *
 
 void Unit::ProgressIscript(const char *caller, ProgressUnitResults *results)
 {
-    UnitIscriptContext ctx(this, results, caller, MainRng(), true);
+    UnitIscriptContext ctx(this, results, caller, IscriptRng(), true);
     ctx.ProgressIscript();
     ctx.CheckDeleted(); // Safe? No idea, needs tests, but works with dying units
 }
 
 void Unit::SetIscriptAnimation(int anim, bool force, const char *caller, ProgressUnitResults *results)
 {
-    UnitIscriptContext(this, results, caller, MainRng(), false).SetIscriptAnimation(anim, force);
+    UnitIscriptContext(this, results, caller, IscriptRng(), false).SetIscriptAnimation(anim, force);
+}
+
+Rng *Unit::IscriptRng()
+{
+    return sprite->rng_stream.Get(ObjectRng::Unit, lookup_id);
 }
 
 void Unit::SetIscriptAnimationForImage(Image *img, int anim)
 {
-    UnitIscriptContext ctx(this, nullptr, "SetIscriptAnimation hook", MainRng(), false);
+    UnitIscriptContext ctx(this, nullptr, "SetIscriptAnimation hook", IscriptRng(), false);
     img->SetIscriptAnimation(&ctx, anim);
 }
 
@@ -4807,7 +4906,7 @@ void Unit::IscriptToIdle()
 {
     flags &= ~UnitStatus::Nobrkcodestart;
     sprite->flags &= ~SpriteFlags::Nobrkcodestart;
-    UnitIscriptContext(this, nullptr, "IscriptToIdle", MainRng(), false).IscriptToIdle();
+    UnitIscriptContext(this, nullptr, "IscriptToIdle", IscriptRng(), false).IscriptToIdle();
     flingy_flags &= ~0x8;
 }
 
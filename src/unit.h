@@ -392,6 +392,74 @@ class Unit
                 constexpr AiReactionPrivate() : picked_target(nullptr) { }
         } ai_reaction_private;
 
+        /// For HashPathValues.
+        class SyncHashPrivate
+        {
+            friend uint32_t HashPathValues(Unit *unit);
+            // Identifies the path values_hash was calculated from
+            const Path *hashed_path;
+            uint32_t hashed_path_frame;
+            uint32_t values_hash;
+
+            public:
+                constexpr SyncHashPrivate() : hashed_path(nullptr), hashed_path_frame(0), values_hash(0) { }
+        } sync_hash_private;
+
+        /// For MainUnitSearch and UnitSearchGrid.
+        class UnitSearchPrivate
+        {
+            friend class MainUnitSearch;
+            friend class UnitSearchGrid;
+            friend class RegionUnitCounts;
+            // Inclusive range of UnitSearchGrid cells the unit is in, cell_left == NoCell if none
+            static const uint16_t NoCell = 0xffff;
+            uint16_t cell_left;
+            uint16_t cell_top;
+            uint16_t cell_right;
+            uint16_t cell_bottom;
+            // Index of the unit in each of its cells, row by row. Units in more cells
+            // than this (only possible with modded dimensions) get searched for instead
+            static const int MaxIndexedCells = 4;
+            uint32_t cell_pos[MaxIndexedCells];
+            // Region and player the unit is counted for in RegionUnitCounts, region == NoRegion if none
+            static const uint16_t NoRegion = 0xffff;
+            uint16_t counted_region;
+            uint8_t counted_player;
+            // GetCurrentStrength(air/ground) results, valid while strength_generation
+            // matches MainUnitSearch::strength_generation
+            uint32_t strength_generation[2];
+            uint32_t strength[2];
+
+            public:
+                constexpr UnitSearchPrivate() : cell_left(NoCell), cell_top(0), cell_right(0), cell_bottom(0),
+                    cell_pos{0, 0, 0, 0}, counted_region(NoRegion), counted_player(0), strength_generation{0, 0}, strength{0, 0} { }
+        } unit_search_private;
+
+        /// Weapons and ranges which only depend on the unit type and upgrades,
+        /// see Unit::UpdateCombatStats.
+        class CombatStatsPrivate
+        {
+            friend class Unit;
+            // Valid while generation matches combat_stats_generation, and the unit has
+            // not been transformed or given to someone else since
+            uint32_t generation;
+            uint16_t unit_id;
+            uint8_t player;
+            // Weapons of the turret
+            uint16_t air_weapon;
+            uint16_t ground_weapon;
+            // GetWeaponRange(air/ground) without the bunker bonus
+            int32_t weapon_range[2];
+            // GetTargetAcquisitionRange() without the cloaked ghost case
+            int32_t acquisition_range;
+            // GetSightRange() without the blind and incomplete building cases
+            int32_t sight_range;
+
+            public:
+                constexpr CombatStatsPrivate() : generation(0), unit_id(0), player(0), air_weapon(0),
+                    ground_weapon(0), weapon_range{0, 0}, acquisition_range(0), sight_range(0) { }
+        } combat_stats_private;
+
         // Funcs etc
 #ifdef SYNC
         void *operator new(size_t size);
@@ -645,6 +713,9 @@ class Unit
         // Flyer movement state is done a bit later so it can be optimized with position search
         // Ground units won't likeyly be so big problem as you can't (usually) stack 1000 of them on top of each other
         void MovementState_Flyer();
+        /// Progresses speeds and positions of every unit in first_movementstate_flyer in one
+        /// batch, MovementState_Flyer then only has to finish the movement.
+        static void PrepareFlyerMovement();
         void FinishMovement_Fast();
         bool MoveFlingy();
 
@@ -653,6 +724,11 @@ class Unit
 
         static ProgressUnitResults ProgressFrames();
         static void ProgressFrames_Invisible();
+        /// Fills combat_stats_private of every active unit, so that the range checks done
+        /// during late unit frames and bullet frames don't have to recalculate them.
+        /// Upgrades and unit types only change during the main unit frames, so
+        /// the results stay valid until the next frame.
+        static void UpdateCombatStats();
         static void UpdatePoweredStates();
 
         // tech.cpp
@@ -684,6 +760,8 @@ class Unit
         void ProgressIscript(const char *caller, ProgressUnitResults *results);
         /// Hack for hooks
         void SetIscriptAnimationForImage(Image *img, int anim);
+        /// Rng for the unit's iscript, MainRng() unless object_rng_streams is enabled
+        Rng *IscriptRng();
 
         void SetIscriptAnimation(int anim, bool force, const char *caller, ProgressUnitResults *results);
 
@@ -707,6 +785,12 @@ class Unit
 
         int CalculateStrength(bool ground) const;
 
+        /// Returns nullptr if combat_stats_private cannot be used
+        const CombatStatsPrivate *CombatStats() const;
+        int CalculateWeaponRange(bool ground) const;
+        int CalculateTargetAcquisitionRange() const;
+        int CalculateSightRange() const;
+
         void ProgressFrame(ProgressUnitResults *results);
         void ProgressFrame_Late(ProgressUnitResults *results);
         void ProgressFrame_Hidden(ProgressUnitResults *results);
@@ -798,9 +882,19 @@ class Unit
 
 extern DummyListHead<Unit, Unit::offset_of_allocated> first_allocated_unit;
 extern DummyListHead<Unit, Unit::offset_of_allocated> first_movementstate_flyer;
+/// If disabled, flyers move one at a time with ProgressFlingy like subunits do
+extern bool batch_flyer_movement;
 
 extern bool late_unit_frames_in_progress;
 
+/// How often Unit::CombatStats could be used, for PerfTest builds. Reset every frame.
+struct CombatStatsCounters
+{
+    std::atomic<uint32_t> hits;
+    std::atomic<uint32_t> misses;
+};
+extern CombatStatsCounters combat_stats_counters;
+
 static_assert(Unit::offset_of_allocated == offsetof(Unit, allocated), "Unit::allocated offset");
 
 #pragma pack(pop)
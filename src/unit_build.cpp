@@ -217,7 +217,7 @@ void Unit::Order_ProtossBuildSelf(ProgressUnitResults *results)
                 order_signal &= ~0x1;
                 bw::ReplaceSprite(sprite->Type().Image().Raw(), 0, sprite.get());
                 Image *image = sprite->main_image;
-                UnitIscriptContext ctx(this, results, "Order_ProtossBuildSelf", MainRng(), false);
+                UnitIscriptContext ctx(this, results, "Order_ProtossBuildSelf", IscriptRng(), false);
                 // Bw actually has iscript header hardcoded as 193
                 image->ExternalAnimation(&ctx, ImageId::WarpTexture, Iscript::Animation::Init);
                 image->SetDrawFunc(Image::UseWarpTexture, image->drawfunc_param);
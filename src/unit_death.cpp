@@ -11,7 +11,9 @@
 #include "ai.h"
 #include "bullet.h"
 #include "offsets.h"
+#include "pathing.h"
 #include "sound.h"
+#include "unitsearch.h"
 #include "yms.h"
 
 static void BuildingCleanup(Unit *unit, ProgressUnitResults *results)
@@ -92,6 +94,7 @@ static void GasBuildingCleanup(Unit *unit)
             unit->order_fow_unit = UnitId::None;
             unit->hitpoints = unit->Type().HitPoints();
             bw::GiveUnit(unit, NeutralPlayer, 0);
+            unit_search->UpdateUnitOwner(unit);
             bw::GiveSprite(unit, NeutralPlayer);
             unit->flags |= UnitStatus::Completed;
             bw::ModifyUnitCounters2(unit, 1, 1);
@@ -293,7 +296,7 @@ static void KillChildren(Unit *unit, ProgressUnitResults *results)
             {
                 unit->ghost.nukedot->SetIscriptAnimation_Lone(Iscript::Animation::Death,
                                                               true,
-                                                              MainRng(),
+                                                              unit->ghost.nukedot->IscriptRng(),
                                                               "Unit KillChildren");
             }
             return;
@@ -361,11 +364,7 @@ static void Die(Unit *unit, ProgressUnitResults *results)
     TransportCleanup(unit, results);
     bw::RemoveReferences(unit, 1);
     // Hak fix
-    for (Unit *other : first_allocated_unit)
-    {
-        if (other->path && other->path->dodge_unit == unit)
-            other->path->dodge_unit = nullptr;
-    }
+    ClearDodgeReferences(unit);
 
     RemoveFromBulletTargets(unit);
     Ai::RemoveUnitAi(unit, true);
@@ -25,12 +25,33 @@ static bool DidUnderflow(uint16_t new_val, uint16_t old_val)
     return new_val > old_val && new_val - old_val > 0x8000;
 }
 
+bool batch_flyer_movement = true;
+static FlingyMotionBatch flyer_motion;
+
+void Unit::PrepareFlyerMovement()
+{
+    STATIC_PERF_CLOCK(Unit_PrepareFlyerMovement);
+    flyer_motion.Clear();
+    if (!batch_flyer_movement)
+        return;
+    for (Unit *unit : first_movementstate_flyer)
+    {
+        bw::ForceMoveTargetInBounds(unit);
+        flyer_motion.Add(unit->AsFlingy());
+    }
+    flyer_motion.Advance();
+}
+
 void Unit::MovementState_Flyer()
 {
     STATIC_PERF_CLOCK(Unit_MovementState_Flyer);
-    bw::ForceMoveTargetInBounds(this);
-
-    AsFlingy()->ProgressFlingy();
+    // Subunits are not in the batch, and neither is anything if batch_flyer_movement is disabled
+    FlingyMoveResults unused;
+    if (!flyer_motion.Finish(AsFlingy(), &unused))
+    {
+        bw::ForceMoveTargetInBounds(this);
+        AsFlingy()->ProgressFlingy();
+    }
 
     bool repulsed = bw::ProgressRepulse(this);
 
@@ -48,6 +69,19 @@ void Unit::MovementState_Flyer()
     bw::FinishRepulse(this, repulsed);
 }
 
+/// bw::MakePath, unless region_path_movement is enabled for the unit
+static int MakePath(Unit *unit, const Point &target)
+{
+    if (!region_path_movement || unit->IsFlying())
+        return bw::MakePath(unit, target.AsDword());
+    // Bw's MakePath keeps the path as long as the target stays same as well
+    if (unit->path && unit->path->end == target)
+        return 1;
+    if (CreateRegionPath(unit, target))
+        return 1;
+    return bw::MakePath(unit, target.AsDword());
+}
+
 int Unit::MovementState13()
 {
     if (path)
@@ -62,7 +96,7 @@ int Unit::MovementState13()
         *bw::dodge_unit_from_path = nullptr;
         return 1;
     }
-    if (bw::MakePath(this, move_target.AsDword()))
+    if (MakePath(this, move_target))
     {
         movement_state = 0x14;
         *bw::dodge_unit_from_path = nullptr;
@@ -83,7 +117,7 @@ int Unit::MovementState17()
         *bw::dodge_unit_from_path = path->dodge_unit;
         DeletePath();
     }
-    if (bw::MakePath(this, move_target.AsDword()))
+    if (MakePath(this, move_target))
         movement_state = MovementState::FollowPath;
     else
         movement_state = 0xf;
@@ -298,7 +332,7 @@ int Unit::MovementState_FollowPath()
 {
     if (bw::UpdateMovementState(this, true))
         return 1;
-    if (bw::MakePath(this, move_target.AsDword()) == 0)
+    if (MakePath(this, move_target) == 0)
     {
         movement_state = 0x16;
         return 1;
@@ -43,6 +43,7 @@ void MainUnitSearch::Validate()
 
 MainUnitSearch::MainUnitSearch()
 {
+    strength_generation = 0;
     capacity = 0x400;
     // This has huge problem as it may be reallocated if used with recursive calls
     // Should use some kind of deque maybe
@@ -67,6 +68,13 @@ void MainUnitSearch::Init()
     region_cache.SetSize((*bw::pathing)->region_count);
     area_cache.SetSize(*bw::map_width, *bw::map_height);
     enemy_unit_cache->SetSize(*bw::map_width, *bw::map_height);
+    grid.SetSize(*bw::map_width, *bw::map_height);
+    region_units.SetSize((*bw::pathing)->region_count);
+    for (unsigned i = 0; i < Size(); i++)
+    {
+        grid.Add(left_to_value[i], SearchBox(i));
+        region_units.Add(left_to_value[i], SearchBox(i));
+    }
 }
 
 void UnitSearch::Init()
@@ -74,11 +82,193 @@ void UnitSearch::Init()
     max_width = *bw::unit_max_width;
 }
 
+Rect32 MainUnitSearch::SearchBox(int pos) const
+{
+    return Rect32(left_positions[pos], left_to_top[pos], left_to_right[pos], left_to_bottom[pos]);
+}
+
+void UnitSearchGrid::SetSize(xuint map_width, yuint map_height)
+{
+    width = ((map_width - 1) >> CellShift) + 1;
+    height = ((map_height - 1) >> CellShift) + 1;
+    cells.clear();
+    cells.resize(width * height);
+}
+
+void UnitSearchGrid::Clear()
+{
+    for (auto &cell : cells)
+        cell.clear();
+}
+
+void UnitSearchGrid::Add(Unit *unit, const Rect32 &box)
+{
+    auto &priv = unit->unit_search_private;
+    priv.cell_left = Unit::UnitSearchPrivate::NoCell;
+    if (width == 0)
+        return;
+    priv.cell_left = CellX(box.left);
+    priv.cell_top = CellY(box.top);
+    priv.cell_right = CellX(max((int)box.left, box.right - 1));
+    priv.cell_bottom = CellY(max((int)box.top, box.bottom - 1));
+    AddToCells(unit);
+}
+
+void UnitSearchGrid::Move(Unit *unit, const Rect32 &box)
+{
+    auto &priv = unit->unit_search_private;
+    if (priv.cell_left == Unit::UnitSearchPrivate::NoCell)
+        return;
+    int left = CellX(box.left), top = CellY(box.top);
+    int right = CellX(max((int)box.left, box.right - 1));
+    int bottom = CellY(max((int)box.top, box.bottom - 1));
+    // Most moves stay inside the same cells
+    if (left == priv.cell_left && top == priv.cell_top && right == priv.cell_right && bottom == priv.cell_bottom)
+        return;
+    RemoveFromCells(unit);
+    priv.cell_left = left;
+    priv.cell_top = top;
+    priv.cell_right = right;
+    priv.cell_bottom = bottom;
+    AddToCells(unit);
+}
+
+void UnitSearchGrid::Remove(Unit *unit)
+{
+    auto &priv = unit->unit_search_private;
+    if (priv.cell_left == Unit::UnitSearchPrivate::NoCell)
+        return;
+    RemoveFromCells(unit);
+    priv.cell_left = Unit::UnitSearchPrivate::NoCell;
+}
+
+void RegionUnitCounts::SetSize(int region_count_)
+{
+    region_count = region_count_;
+    counts.clear();
+    counts.resize(region_count * Limits::Players, 0);
+    totals.clear();
+    totals.resize(region_count, 0);
+}
+
+void RegionUnitCounts::Clear()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(totals.begin(), totals.end(), 0);
+}
+
+// Uses the unit search box instead of sprite position, so the region always matches
+// what the unit search has
+static int RegionFromBox(Unit *unit, const Rect32 &box)
+{
+    const Rect16 dbox = unit->Type().DimensionBox();
+    return GetRegion(Point(box.left + dbox.left, box.top + dbox.top));
+}
+
+void RegionUnitCounts::Add(Unit *unit, const Rect32 &box)
+{
+    auto &priv = unit->unit_search_private;
+    priv.counted_region = Unit::UnitSearchPrivate::NoRegion;
+    if (region_count == 0 || unit->player >= Limits::Players)
+        return;
+    int region = RegionFromBox(unit, box);
+    if (region >= region_count)
+        return;
+    priv.counted_region = region;
+    priv.counted_player = unit->player;
+    counts[region * Limits::Players + unit->player] += 1;
+    totals[region] += 1;
+}
+
+void RegionUnitCounts::Move(Unit *unit, const Rect32 &box)
+{
+    auto &priv = unit->unit_search_private;
+    if (priv.counted_region == Unit::UnitSearchPrivate::NoRegion)
+        return;
+    if (priv.counted_player == unit->player && RegionFromBox(unit, box) == priv.counted_region)
+        return;
+    Remove(unit);
+    Add(unit, box);
+}
+
+void RegionUnitCounts::UpdateOwner(Unit *unit, const Rect32 &box)
+{
+    auto &priv = unit->unit_search_private;
+    if (priv.counted_region == Unit::UnitSearchPrivate::NoRegion || priv.counted_player == unit->player)
+        return;
+    Remove(unit);
+    Add(unit, box);
+}
+
+void RegionUnitCounts::Remove(Unit *unit)
+{
+    auto &priv = unit->unit_search_private;
+    if (priv.counted_region == Unit::UnitSearchPrivate::NoRegion)
+        return;
+    counts[priv.counted_region * Limits::Players + priv.counted_player] -= 1;
+    totals[priv.counted_region] -= 1;
+    priv.counted_region = Unit::UnitSearchPrivate::NoRegion;
+}
+
+int UnitSearchGrid::CellSlot(const Unit *unit, int x, int y)
+{
+    const auto &priv = unit->unit_search_private;
+    int cells_x = priv.cell_right - priv.cell_left + 1;
+    int cells_y = priv.cell_bottom - priv.cell_top + 1;
+    if (cells_x * cells_y > Unit::UnitSearchPrivate::MaxIndexedCells)
+        return -1;
+    return (y - priv.cell_top) * cells_x + (x - priv.cell_left);
+}
+
+void UnitSearchGrid::AddToCells(Unit *unit)
+{
+    auto &priv = unit->unit_search_private;
+    for (int y = priv.cell_top; y <= priv.cell_bottom; y++)
+    {
+        for (int x = priv.cell_left; x <= priv.cell_right; x++)
+        {
+            auto &cell = cells[y * width + x];
+            int slot = CellSlot(unit, x, y);
+            if (slot != -1)
+                priv.cell_pos[slot] = cell.size();
+            cell.emplace_back(unit);
+        }
+    }
+}
+
+void UnitSearchGrid::RemoveFromCells(Unit *unit)
+{
+    const auto &priv = unit->unit_search_private;
+    for (int y = priv.cell_top; y <= priv.cell_bottom; y++)
+    {
+        for (int x = priv.cell_left; x <= priv.cell_right; x++)
+        {
+            auto &cell = cells[y * width + x];
+            int slot = CellSlot(unit, x, y);
+            uint32_t pos;
+            if (slot != -1)
+                pos = priv.cell_pos[slot];
+            else
+                pos = std::find(cell.begin(), cell.end(), unit) - cell.begin();
+            Assert(pos < cell.size() && cell[pos] == unit);
+            Unit *moved = cell.back();
+            cell[pos] = moved;
+            cell.pop_back();
+            int moved_slot = CellSlot(moved, x, y);
+            if (moved_slot != -1)
+                moved->unit_search_private.cell_pos[moved_slot] = pos;
+        }
+    }
+}
+
 void MainUnitSearch::Clear()
 {
     PosSearch::Clear();
+    grid.Clear();
+    region_units.Clear();
     left_low_invalid = INT_MAX;
     left_high_invalid = -1;
+    moved_lefts.clear();
     valid_region_cache = false;
     area_cache_enabled = false;
 }
@@ -117,6 +307,8 @@ void MainUnitSearch::Add(Unit *unit)
     PosSearch::Add(pos, move(unit), box);
 
     unit->search_left = pos;
+    grid.Add(unit, SearchBox(pos));
+    region_units.Add(unit, SearchBox(pos));
 
     area_cache_enabled = false;
     Validate();
@@ -219,6 +411,67 @@ Unit **MainUnitSearch::FindUnitsRect(const Rect16 &rect, int *amount, Unit **out
     return ret;
 }
 
+void MainUnitSearch::FindUnitsRects(const vector<Rect16> &rects, vector<Unit *> *out_units, vector<uint32_t> *out_offsets)
+{
+    STATIC_PERF_CLOCK(UnitSearch_FindUnitsRects);
+    // A rect contains units whose left is in [rect.left - max_width, rect.right), like in
+    // PosSearch::Find. The rects are sorted by the start of that range, so that a sweep
+    // over left positions can keep track of the rects which may contain the current unit.
+    auto &order = find_rects_order;
+    auto &active = find_rects_active;
+    auto &results = find_rects_results;
+    order.resize(rects.size());
+    for (uint32_t i = 0; i < rects.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return rects[a].left < rects[b].left || (rects[a].left == rects[b].left && a < b);
+    });
+    active.clear();
+    results.clear();
+
+    uint32_t next = 0;
+    unsigned int it = 0;
+    while (it < Size())
+    {
+        if (active.empty())
+        {
+            // Skip the units which no rect contains
+            if (next == order.size())
+                break;
+            it = std::max(it, (unsigned int)NewFind(rects[order[next]].left - max_width));
+            if (it >= Size())
+                break;
+        }
+        x32 left = left_positions[it];
+        while (next < order.size() && rects[order[next]].left - max_width <= left)
+            active.push_back(order[next++]);
+        active.erase(std::remove_if(active.begin(), active.end(), [&](uint32_t index) {
+            return rects[index].right <= left;
+        }), active.end());
+        for (uint32_t index : active)
+        {
+            const Rect16 &rect = rects[index];
+            if (left_to_right[it] > rect.left && rect.top < left_to_bottom[it] && rect.bottom > left_to_top[it])
+                results.emplace_back(index, left_to_value[it]);
+        }
+        it++;
+    }
+
+    // Group the results by rect, keeping the units of each rect in the order they were found
+    out_offsets->assign(rects.size() + 1, 0);
+    for (const auto &result : results)
+        (*out_offsets)[result.first + 1] += 1;
+    for (uint32_t i = 0; i < rects.size(); i++)
+        (*out_offsets)[i + 1] += (*out_offsets)[i];
+    out_units->resize(results.size());
+    for (const auto &result : results)
+        (*out_units)[(*out_offsets)[result.first]++] = result.second;
+    // The loop above moved each offset to the start of the following rect
+    for (uint32_t i = rects.size(); i > 0; i--)
+        (*out_offsets)[i] = (*out_offsets)[i - 1];
+    (*out_offsets)[0] = 0;
+}
+
 void MainUnitSearch::AreaCacheFind(const Rect16 &rect, Unit **out, Unit ***out_end, UnitSearchAreaCache::AreaBuffer<Unit *> *out_bufs, UnitSearchAreaCache::AreaBuffer<Unit *> **out_bufs_end)
 {
     STATIC_PERF_CLOCK(UnitSearch_AreaCacheFind);
@@ -427,10 +680,24 @@ void MainUnitSearch::ChangeUnitPosition(Unit *unit, int x_diff, int y_diff)
         rotate(left_to_right.begin() + new_pos, left_to_right.begin() + pos, left_to_right.begin() + pos + 1);
         unit->search_left = new_pos;
     }
+    grid.Move(unit, SearchBox(unit->search_left));
+    region_units.Move(unit, SearchBox(unit->search_left));
     area_cache_enabled = false;
     Validate();
 }
 
+void MainUnitSearch::UpdateUnitOwner(Unit *unit)
+{
+    if (unit->search_left != -1)
+        region_units.UpdateOwner(unit, SearchBox(unit->search_left));
+}
+
+void MainUnitSearch::UpdateAllUnitOwners()
+{
+    for (unsigned pos = 0; pos < left_to_value.size(); pos++)
+        region_units.UpdateOwner(left_to_value[pos], SearchBox(pos));
+}
+
 void MainUnitSearch::ChangeUnitPosition_Fast(Unit *unit, int x_diff, int y_diff)
 {
     if (x_diff < 0)
@@ -446,136 +713,151 @@ void MainUnitSearch::ChangeUnitPosition_Fast(Unit *unit, int x_diff, int y_diff)
     if (x_diff != 0)
     {
         Assert(left_low_invalid >= 0 && left_high_invalid >= 0);
+        moved_lefts.push_back(unit->search_left);
     }
     left_positions[unit->search_left] += x_diff;
     left_to_right[unit->search_left] += x_diff;
     left_to_top[unit->search_left] += y_diff;
     left_to_bottom[unit->search_left] += y_diff;
+    grid.Move(unit, SearchBox(unit->search_left));
+    region_units.Move(unit, SearchBox(unit->search_left));
 }
 
-class SortHelperBase
+const char *MainUnitSearch::ResortMethodName(ResortMethod method)
 {
-    public:
-        typedef std::ptrdiff_t diff;
-        template <class Parent>
-        class ValueRef
-        {
-            public:
-                ValueRef(Parent *parent_, int pos_) : parent(parent_), pos(pos_) {}
-                bool operator<(const ValueRef &other) const { return parent->beg[pos] < parent->beg[other.pos]; }
-                bool operator<(const typename Parent::Value &other) const { return parent->beg[pos] < other.val; }
-                //operator typename Parent::Value() const { return typename Parent::Value(parent, pos); }
-                ValueRef &operator=(const typename Parent::Value &val) { parent->SetVal(pos, val); return *this; }
-                ValueRef &operator=(const ValueRef &other) { parent->SetVal(pos, other); return *this; }
-                Parent * const parent;
-                const int pos;
-        };
-
-        SortHelperBase(x32 *pos_, x32 * const beg_) : pos(pos_), beg(beg_) {}
-
-        bool operator==(const SortHelperBase &other) const { return pos == other.pos; }
-        bool operator!=(const SortHelperBase &other) const { return !(*this == other); }
-        bool operator<(const SortHelperBase &other) const { return pos < other.pos; }
-        bool operator>=(const SortHelperBase &other) const { return !(*this < other); }
-        bool operator>(const SortHelperBase &other) const { return pos > other.pos; }
-        bool operator<=(const SortHelperBase &other) const { return !(*this > other); }
-
-        x32 *pos;
-        x32 * const beg;
-};
+    switch (method)
+    {
+        case ResortMethod::None: return "None";
+        case ResortMethod::Insertion: return "Insertion";
+        case ResortMethod::Merge: return "Merge";
+        case ResortMethod::Radix: return "Radix";
+    }
+    return "???";
+}
 
-class LeftSortHelper : public SortHelperBase
+void MainUnitSearch::InsertionSortLeft(int low, int high)
 {
-    public:
-        struct Value
-        {
-            Value(ValueRef<LeftSortHelper> &&other)
-            {
-                *this = std::move(other);
-            }
-            Value &operator=(ValueRef<LeftSortHelper> &&other)
-            {
-                auto *parent = other.parent;
-                val = parent->beg[other.pos];
-                unit = parent->unit[other.pos];
-                top = parent->top[other.pos];
-                bottom = parent->bottom[other.pos];
-                right = parent->right[other.pos];
-                return *this;
-            }
-            bool operator<(const ValueRef<LeftSortHelper> &other) const { return val < other.parent->beg[other.pos]; }
-            x32 val;
-            Unit *unit;
-            y32 top;
-            y32 bottom;
-            x32 right;
-        };
-        void SetVal(int pos, const Value &val)
-        {
-            beg[pos] = val.val;
-            unit[pos] = val.unit;
-            top[pos] = val.top;
-            bottom[pos] = val.bottom;
-            right[pos] = val.right;
-        }
-        void SetVal(int pos, const ValueRef<LeftSortHelper> &val)
+    for (int i = low + 1; i < high; i++)
+    {
+        if (left_positions[i - 1] <= left_positions[i])
+            continue;
+        LeftEntry entry = GetLeftEntry(i);
+        int pos = i;
+        while (pos > low && left_positions[pos - 1] > entry.left)
         {
-            beg[pos] = beg[val.pos];
-            unit[pos] = unit[val.pos];
-            top[pos] = top[val.pos];
-            bottom[pos] = bottom[val.pos];
-            right[pos] = right[val.pos];
+            SetLeftEntry(pos, GetLeftEntry(pos - 1));
+            pos--;
         }
-        LeftSortHelper(MainUnitSearch *parent, x32 *pos_) : SortHelperBase(pos_, parent->left_positions.data()),
-            unit(parent->left_to_value.data()), top(parent->left_to_top.data()), bottom(parent->left_to_bottom.data()),
-            right(parent->left_to_right.data())
-            { }
-        LeftSortHelper &operator=(const LeftSortHelper &other) { pos = other.pos; return *this; }
-
-        ValueRef<LeftSortHelper> operator*() { return ValueRef<LeftSortHelper>(this, pos - beg); }
-        LeftSortHelper operator-(diff val) const { LeftSortHelper ret(*this); ret -= val; return ret; }
-        LeftSortHelper operator+(diff val) const { LeftSortHelper ret(*this); ret += val; return ret; }
-        LeftSortHelper &operator+=(diff val) { pos += val; return *this; }
-        LeftSortHelper &operator-=(diff val) { pos -= val; return *this; }
-        LeftSortHelper &operator++() { return *this += 1; }
-        LeftSortHelper operator++(int) { LeftSortHelper copy(*this); *this += 1; return copy; }
-        LeftSortHelper &operator--() { return *this -= 1; }
-        LeftSortHelper operator--(int) { LeftSortHelper copy(*this); *this -= 1; return copy; }
-        diff operator-(const LeftSortHelper &other) const { return pos - other.pos; }
-        Unit ** const unit;
-        y32 * const top;
-        y32 * const bottom;
-        x32 * const right;
-};
+        SetLeftEntry(pos, entry);
+    }
+}
 
-void swap(SortHelperBase::ValueRef<LeftSortHelper> a, SortHelperBase::ValueRef<LeftSortHelper> b)
+// The units that did not move are still sorted, so only the moved ones have to be sorted.
+// moved_lefts has to be sorted and contain only indices between low and high.
+void MainUnitSearch::MergeMovedLeft(int low, int high)
 {
-    using std::swap;
-    LeftSortHelper *parent = a.parent;
-    swap(parent->unit[a.pos], parent->unit[b.pos]);
-    swap(parent->top[a.pos], parent->top[b.pos]);
-    swap(parent->bottom[a.pos], parent->bottom[b.pos]);
-    swap(parent->right[a.pos], parent->right[b.pos]);
-    swap(parent->beg[a.pos], parent->beg[b.pos]);
+    resort_entries.clear();
+    resort_moved.clear();
+    auto moved_it = moved_lefts.begin();
+    for (int i = low; i < high; i++)
+    {
+        if (moved_it != moved_lefts.end() && *moved_it == (uint32_t)i)
+        {
+            resort_moved.push_back(GetLeftEntry(i));
+            ++moved_it;
+        }
+        else
+            resort_entries.push_back(GetLeftEntry(i));
+    }
+    std::sort(resort_moved.begin(), resort_moved.end());
+    int pos = low;
+    auto unmoved = resort_entries.begin();
+    auto moved = resort_moved.begin();
+    while (unmoved != resort_entries.end() && moved != resort_moved.end())
+    {
+        if (*moved < *unmoved)
+            SetLeftEntry(pos++, *moved++);
+        else
+            SetLeftEntry(pos++, *unmoved++);
+    }
+    for (; unmoved != resort_entries.end(); ++unmoved)
+        SetLeftEntry(pos++, *unmoved);
+    for (; moved != resort_moved.end(); ++moved)
+        SetLeftEntry(pos++, *moved);
 }
 
-namespace std {
-template <>
-struct iterator_traits<LeftSortHelper>
+// Lsd radix sort, 8 bits at a time
+void MainUnitSearch::RadixSortLeft(int low, int high)
 {
-    typedef std::ptrdiff_t difference_type;
-    typedef SortHelperBase::ValueRef<LeftSortHelper> reference;
-    typedef LeftSortHelper::Value value_type;
-    typedef std::random_access_iterator_tag iterator_category;
-};
+    resort_entries.clear();
+    int min = INT_MAX, max = INT_MIN;
+    for (int i = low; i < high; i++)
+    {
+        resort_entries.push_back(GetLeftEntry(i));
+        min = std::min(min, (int)left_positions[i]);
+        max = std::max(max, (int)left_positions[i]);
+    }
+    if (max - min >= 0x10000)
+    {
+        // Not possible with maps of bw's size
+        std::sort(resort_entries.begin(), resort_entries.end());
+    }
+    else
+    {
+        resort_moved.resize(resort_entries.size());
+        for (int shift = 0; shift < 16; shift += 8)
+        {
+            uint32_t offsets[0x100] = { 0 };
+            for (const LeftEntry &entry : resort_entries)
+                offsets[(((int)entry.left - min) >> shift) & 0xff] += 1;
+            uint32_t total = 0;
+            for (uint32_t &offset : offsets)
+            {
+                uint32_t count = offset;
+                offset = total;
+                total += count;
+            }
+            for (const LeftEntry &entry : resort_entries)
+                resort_moved[offsets[(((int)entry.left - min) >> shift) & 0xff]++] = entry;
+            resort_entries.swap(resort_moved);
+        }
+    }
+    for (int i = low; i < high; i++)
+        SetLeftEntry(i, resort_entries[i - low]);
 }
 
 void MainUnitSearch::ChangeUnitPosition_Finish()
 {
+    last_resort = ResortStats();
     if (left_high_invalid != -1)
     {
         int low = NewFind(left_low_invalid), high = NewFind(left_high_invalid + 1);
-        std::sort(LeftSortHelper(this, left_positions.data() + low), LeftSortHelper(this, left_positions.data() + high));
+        std::sort(moved_lefts.begin(), moved_lefts.end());
+        moved_lefts.erase(std::unique(moved_lefts.begin(), moved_lefts.end()), moved_lefts.end());
+        // The span covers old positions of the moved units, but don't trust that in case
+        // NewFind gets confused by the unsorted positions
+        auto moved_begin = std::lower_bound(moved_lefts.begin(), moved_lefts.end(), (uint32_t)low);
+        auto moved_end = std::lower_bound(moved_begin, moved_lefts.end(), (uint32_t)high);
+        moved_lefts.erase(moved_end, moved_lefts.end());
+        moved_lefts.erase(moved_lefts.begin(), moved_begin);
+
+        last_resort.span = high - low;
+        last_resort.moved = moved_lefts.size();
+        if (last_resort.moved <= 8)
+        {
+            last_resort.method = ResortMethod::Insertion;
+            InsertionSortLeft(low, high);
+        }
+        else if (last_resort.moved * 4 <= last_resort.span)
+        {
+            last_resort.method = ResortMethod::Merge;
+            MergeMovedLeft(low, high);
+        }
+        else
+        {
+            last_resort.method = ResortMethod::Radix;
+            RadixSortLeft(low, high);
+        }
         for (int i = low; i < high; i++)
         {
             Unit *unit = left_to_value[i];
@@ -585,6 +867,7 @@ void MainUnitSearch::ChangeUnitPosition_Finish()
         left_low_invalid = INT_MAX;
         left_high_invalid = -1;
     }
+    moved_lefts.clear();
     area_cache_enabled = false;
     Validate();
 }
@@ -688,6 +971,8 @@ void MainUnitSearch::Remove(Unit *unit)
         unit->search_left = i - 1;
     }
 
+    grid.Remove(unit);
+    region_units.Remove(unit);
     RemoveAt(unit->search_left);
     unit->search_left = -1;
     unit->search_right = -1;
@@ -872,6 +1157,7 @@ void MainUnitSearch::ClearRegionCache()
 {
     region_cache.Clear();
     valid_region_cache = true;
+    strength_generation += 1;
 }
 
 void MainUnitSearch::EnableAreaCache()
@@ -997,11 +1283,26 @@ struct iterator_traits<ChooseTargetSort>
 };
 }
 
+uint32_t MainUnitSearch::CurrentStrength(Unit *unit, bool ground)
+{
+    auto &priv = unit->unit_search_private;
+    if (priv.strength_generation[ground] != strength_generation)
+    {
+        priv.strength_generation[ground] = strength_generation;
+        priv.strength[ground] = bw::GetCurrentStrength(unit, ground);
+    }
+    return priv.strength[ground];
+}
+
 // Result is sorted by GetCurrentStrength(ground), so ChooseTarget can stop as soon as it finds
 // acceptable unit
 // Returns one array for each player
 UnitSearchRegionCache::Entry MainUnitSearch::FindUnits_ChooseTarget(int region_id, bool ground)
 {
+    auto &units = choose_target_units;
+    auto &strengths = choose_target_strengths;
+    units.clear();
+    strengths.clear();
     if (!valid_region_cache)
     {
         ClearRegionCache();
@@ -1015,42 +1316,31 @@ UnitSearchRegionCache::Entry MainUnitSearch::FindUnits_ChooseTarget(int region_i
         if (entry)
         {
             auto size = entry.take().Size();
+            Unit **other = entry.take().GetRaw();
+            units.assign(other, other + size);
+            for (Unit *unit : units)
+                strengths.emplace_back(CurrentStrength(unit, ground));
+            Unit **base = units.data();
+            std::sort(ChooseTargetSort(base, base, strengths.data()), ChooseTargetSort(base, base + size, strengths.data()));
             Unit **copy = region_cache.NewEntry(size);
-            memcpy(copy, entry.take().GetRaw(), size * sizeof(Unit *));
-            auto str_beg = make_unique<uint32_t[]>(size);
-            auto str_end = str_beg.get() + size;
-            for (auto str_out = str_beg.get(); str_out != str_end; str_out++)
-            {
-                auto i = str_out - str_beg.get();
-                *str_out = bw::GetCurrentStrength(copy[i], ground);
-            }
-            std::sort(ChooseTargetSort(copy, copy, str_beg.get()), ChooseTargetSort(copy, copy + size, str_beg.get()));
+            memcpy(copy, base, size * sizeof(Unit *));
             return region_cache.FinishEntry(copy, region_id, ground, size);
         }
     }
     STATIC_PERF_CLOCK(UnitSearch_FindUnits_ChooseTarget);
 
-    // Based on FindUnitBordersRect
+    // Based on FindUnitBordersRect, but only looks at the units in the grid cells near the region
     Pathing::Region *region = (*bw::pathing)->regions + region_id;
     Rect16 rect(Point(region->x >> 8, region->y >> 8), 0x120);
-    Unit **out, **result_beg;
-
-    out = result_beg = region_cache.NewEntry(Size() + 1);
-    // Allocate a separate array to hold GetCurrentStrength as calling it for every comparision is slow
-    // (first field is entry to out[], second is the strength)
-    auto str_beg = make_unique<uintptr_t[]>(Size() + 1);
-    uintptr_t *str_out = str_beg.get();
-    unsigned int beg, end;
-    beg = NewFind(rect.left - *bw::unit_max_width);
-    end = NewFind(rect.right);
-
-    for (unsigned int it = beg; it < end; it++)
-    {
-        if (left_to_right[it] > rect.left)
+    int min_left = rect.left - *bw::unit_max_width;
+    grid.ForEachUnit(rect, [&](Unit *unit) {
+        int pos = unit->search_left;
+        if (left_positions[pos] < min_left || left_positions[pos] >= rect.right)
+            return;
+        if (left_to_right[pos] > rect.left)
         {
-            if (rect.top < left_to_bottom[it] && rect.bottom > left_to_top[it])
+            if (rect.top < left_to_bottom[pos] && rect.bottom > left_to_top[pos])
             {
-                Unit *unit = left_to_value[it];
                 if (unit->OrderType() != OrderId::Die && !unit->IsInvincible())
                 {
                     // FindUnitBordersRect does this to be truly "borders only",
@@ -1060,18 +1350,22 @@ UnitSearchRegionCache::Entry MainUnitSearch::FindUnits_ChooseTarget(int region_i
                     //     continue;
                     if (~unit->flags & UnitStatus::Hallucination || unit->GetHealth() == unit->GetMaxHealth())
                     {
-                        *out++ = unit;
-                        *str_out = bw::GetCurrentStrength(unit, ground);
-                        str_out++;
+                        units.emplace_back(unit);
+                        strengths.emplace_back(CurrentStrength(unit, ground));
                     }
                 }
             }
         }
-    }
+    });
 
     STATIC_PERF_CLOCK(UnitSearch_FindUnits_CT_sort);
-    std::sort(ChooseTargetSort(result_beg, result_beg, str_beg.get()), ChooseTargetSort(result_beg, out, str_beg.get()));
-    return region_cache.FinishEntry(result_beg, region_id, ground, out - result_beg);
+    // The order is unique, so the order of grid cells does not affect the result
+    auto size = units.size();
+    Unit **base = units.data();
+    std::sort(ChooseTargetSort(base, base, strengths.data()), ChooseTargetSort(base, base + size, strengths.data()));
+    Unit **result_beg = region_cache.NewEntry(size);
+    memcpy(result_beg, base, size * sizeof(Unit *));
+    return region_cache.FinishEntry(result_beg, region_id, ground, size);
 }
 
 Unit **MainUnitSearch::FindHelpingUnits(Unit *own, const Rect16 &rect, TempMemoryPool *allocation_pool)
@@ -2,9 +2,12 @@
 #define UNIT_SEARCH_H
 
 #include "types.h"
+#include "limits.h"
 #include "unit.h"
 #include "unitsearch_cache.h"
 
+#include <algorithm>
+
 #pragma pack(push)
 #pragma pack(1)
 struct UnitPositions
@@ -22,9 +25,6 @@ struct CollisionArea
 
 #pragma pack(pop)
 
-class LeftSortHelper;
-class RightSortHelper;
-
 template <class Type>
 class PosSearch
 {
@@ -74,12 +74,103 @@ class UnitSearch : protected PosSearch<Unit *>
         bool DoesBlockArea(const Unit *unit, const CollisionArea *area) const;
 };
 
+/// Coarse grid of the units in MainUnitSearch, so that FindUnits_ChooseTarget only has to look
+/// at units near the searched region instead of a strip spanning the entire map height.
+/// A unit is in every cell its collision box touches, and the cells are not in any
+/// particular order.
+class UnitSearchGrid
+{
+    public:
+        static const int CellShift = 8;
+
+        UnitSearchGrid() : width(0), height(0) {}
+        UnitSearchGrid(UnitSearchGrid &&other) = default;
+
+        void SetSize(xuint map_width, yuint map_height);
+        void Clear();
+        /// Does nothing before SetSize(), MainUnitSearch::Init adds the units again.
+        void Add(Unit *unit, const Rect32 &box);
+        void Move(Unit *unit, const Rect32 &box);
+        void Remove(Unit *unit);
+
+        /// Calls func(unit) once for each unit in the cells touching rect,
+        /// the caller has to check whether the unit actually is in rect.
+        template <class Func>
+        void ForEachUnit(const Rect16 &rect, Func func) const
+        {
+            if (width == 0)
+                return;
+            int left = CellX(rect.left), top = CellY(rect.top);
+            int right = CellX(std::max((int)rect.left, rect.right - 1));
+            int bottom = CellY(std::max((int)rect.top, rect.bottom - 1));
+            for (int y = top; y <= bottom; y++)
+            {
+                for (int x = left; x <= right; x++)
+                {
+                    for (Unit *unit : cells[y * width + x])
+                    {
+                        // Only report the unit from the first cell it shares with rect
+                        const auto &priv = unit->unit_search_private;
+                        if (std::max((int)priv.cell_left, left) == x && std::max((int)priv.cell_top, top) == y)
+                            func(unit);
+                    }
+                }
+            }
+        }
+
+    private:
+        int CellX(int x) const { return std::max(0, std::min(x >> CellShift, width - 1)); }
+        int CellY(int y) const { return std::max(0, std::min(y >> CellShift, height - 1)); }
+        void AddToCells(Unit *unit);
+        void RemoveFromCells(Unit *unit);
+        /// Index to unit_search_private.cell_pos for cell (x, y), or -1 if it is not indexed
+        static int CellSlot(const Unit *unit, int x, int y);
+
+        vector<vector<Unit *>> cells;
+        int width;
+        int height;
+};
+
+/// Amount of units each player has in each pathing region, kept up to date as units are added to,
+/// moved in and removed from MainUnitSearch. The region of an unit is the one its position is in.
+/// Bw may change unit's owner without telling us (e.g. rescuing), so code which gives units
+/// has to call MainUnitSearch::UpdateUnitOwner. Bw's give units trigger action gives them
+/// directly, so it is followed by MainUnitSearch::UpdateAllUnitOwners.
+class RegionUnitCounts
+{
+    public:
+        RegionUnitCounts() : region_count(0) {}
+        RegionUnitCounts(RegionUnitCounts &&other) = default;
+
+        void SetSize(int region_count);
+        void Clear();
+        /// Does nothing before SetSize(), MainUnitSearch::Init adds the units again.
+        void Add(Unit *unit, const Rect32 &box);
+        /// Also notices if the owner has changed
+        void Move(Unit *unit, const Rect32 &box);
+        /// Cheaper than Move if the unit has stayed in its region
+        void UpdateOwner(Unit *unit, const Rect32 &box);
+        void Remove(Unit *unit);
+
+        /// True if anyone else than player has units in the region
+        bool HasOthersUnits(int region, int player) const
+        {
+            if (region >= region_count)
+                return true;
+            return totals[region] != counts[region * Limits::Players + player];
+        }
+
+    private:
+        vector<uint16_t> counts;
+        vector<uint16_t> totals;
+        int region_count;
+};
+
 // While units may be included in multiple UnitSearches, they may only be part of one MainUnitSearch
 // (MainUnitSearch uses unit->search_left, allowing faster/more operations)
 // Also includes bw shims and search caches
 class MainUnitSearch : public UnitSearch
 {
-    friend class LeftSortHelper;
     public:
         typedef UnitSearchAreaCache::AreaBuffer<Unit *> AreaCacheBuf;
         MainUnitSearch();
@@ -98,6 +189,11 @@ class MainUnitSearch : public UnitSearch
         // FindUnitBordersRect didn't include right and bottom coords in bw, so it won't cause issues
         // (No clue about more specialized functions)
         Unit **FindUnitsRect(const Rect16 &rect, int *amount = nullptr, Unit **out = nullptr);
+        /// Searches all rects with a single pass over the units, which is cheaper than calling
+        /// FindUnitsRect for each of them when there are many rects close to each other.
+        /// Units of rects[i] are out_units[out_offsets[i]] .. out_units[out_offsets[i + 1]], sorted
+        /// by left like UnitSearch::Find sorts them (the area cache is not used).
+        void FindUnitsRects(const vector<Rect16> &rects, vector<Unit *> *out_units, vector<uint32_t> *out_offsets);
 
         // Bw compatibility functions
         Unit **FindUnitBordersRect(const Rect16 *rect);
@@ -110,6 +206,30 @@ class MainUnitSearch : public UnitSearch
         void ChangeUnitPosition_Fast(Unit *unit, int x_diff, int y_diff);
         void ChangeUnitPosition_Finish();
 
+        /// How ChangeUnitPosition_Finish re-sorted the units. All of them keep units with
+        /// same left in their previous order, so the result does not depend on the method.
+        enum class ResortMethod
+        {
+            None,
+            /// Few moved units, each gets shifted to its place
+            Insertion,
+            /// Moved units are sorted separately and merged with the ones that stayed
+            Merge,
+            /// Most of the invalidated span moved
+            Radix,
+        };
+        struct ResortStats
+        {
+            ResortStats() : method(ResortMethod::None), span(0), moved(0) {}
+            ResortMethod method;
+            /// Amount of units in the invalidated span
+            uint32_t span;
+            uint32_t moved;
+        };
+        /// Stats of the latest ChangeUnitPosition_Finish
+        const ResortStats &LastResort() const { return last_resort; }
+        static const char *ResortMethodName(ResortMethod method);
+
         // Bw-compatible signature
         Unit *FindNearestUnit(Unit *self, const Point &pos, int (__fastcall *IsValid)(const Unit *, void *), void *func_param, const Rect16 &area_);
 
@@ -123,6 +243,12 @@ class MainUnitSearch : public UnitSearch
         void PopResult();
 
         UnitSearchRegionCache::Entry FindUnits_ChooseTarget(int region, bool ground);
+        /// Cheap check for ai, false means that GetEnemyStrength of the region is 0 for player.
+        bool HasOthersUnitsInRegion(int region, int player) const { return region_units.HasOthersUnits(region, player); }
+        /// Has to be called after giving the unit to another player
+        void UpdateUnitOwner(Unit *unit);
+        /// For when bw has given units without telling which ones
+        void UpdateAllUnitOwners();
         Unit **FindHelpingUnits(Unit *unit, const Rect16 &rect, TempMemoryPool *allocation_pool);
         void ClearRegionCache();
         void EnableAreaCache();
@@ -166,13 +292,68 @@ class MainUnitSearch : public UnitSearch
         bool area_cache_enabled;
         UnitSearchAreaCache area_cache;
 
+        UnitSearchGrid grid;
+        RegionUnitCounts region_units;
+        // Unit::unit_search_private.strength is valid if it has this generation,
+        // a new one is started whenever the region cache gets cleared
+        uint32_t strength_generation;
+        // Reused buffers for FindUnits_ChooseTarget
+        vector<Unit *> choose_target_units;
+        vector<uint32_t> choose_target_strengths;
+        // Reused buffers for FindUnitsRects
+        vector<uint32_t> find_rects_order;
+        vector<uint32_t> find_rects_active;
+        vector<std::pair<uint32_t, Unit *>> find_rects_results;
+
         void Validate();
+        Rect32 SearchBox(int pos) const;
+        uint32_t CurrentStrength(Unit *unit, bool ground);
 
         AreaCacheBuf reasonable_area_cache_buf[32 * 32];
 
         // ChangeUnitPosition_Fast uses these
         x32 left_low_invalid;
         x32 left_high_invalid;
+        /// search_left of every unit which ChangeUnitPosition_Fast moved horizontally,
+        /// they do not change until ChangeUnitPosition_Finish
+        vector<uint32_t> moved_lefts;
+
+        /// Copy of the parallel left_* arrays at one index
+        struct LeftEntry
+        {
+            x32 left;
+            Unit *unit;
+            y32 top;
+            y32 bottom;
+            x32 right;
+            /// Index the entry was copied from, SetLeftEntry ignores it
+            uint32_t pos;
+
+            bool operator<(const LeftEntry &other) const
+            {
+                return left < other.left || (left == other.left && pos < other.pos);
+            }
+        };
+        LeftEntry GetLeftEntry(int pos) const
+        {
+            return LeftEntry { left_positions[pos], left_to_value[pos], left_to_top[pos], left_to_bottom[pos],
+                left_to_right[pos], (uint32_t)pos };
+        }
+        void SetLeftEntry(int pos, const LeftEntry &entry)
+        {
+            left_positions[pos] = entry.left;
+            left_to_value[pos] = entry.unit;
+            left_to_top[pos] = entry.top;
+            left_to_bottom[pos] = entry.bottom;
+            left_to_right[pos] = entry.right;
+        }
+        void InsertionSortLeft(int low, int high);
+        void MergeMovedLeft(int low, int high);
+        void RadixSortLeft(int low, int high);
+        // Reused buffers for the re-sorts
+        vector<LeftEntry> resort_entries;
+        vector<LeftEntry> resort_moved;
+        ResortStats last_resort;
 };
 
 extern MainUnitSearch *unit_search;
@@ -299,6 +299,14 @@ class UnsortedList : protected Allocator
             size_ -= 1;
         }
 
+        /// Like entry::swap_erase, but for a position kept from an earlier iteration.
+        /// When erasing several positions, they have to be erased starting from the last one,
+        /// as the object from the end is moved to take the erased one's place.
+        void swap_erase(iterator pos) {
+            *pos = std::move(back());
+            pop();
+        }
+
         uintptr_t size() const { return size_; }
 
 
@@ -30,6 +30,7 @@ void FatalError(const char *format, ...)
     va_end(varg);
     MessageBoxA(0, buf, "Fatal error", 0);
     error_log->Log("Fatal error: %s\n", buf);
+    FlushAsyncLogs(1000);
     if (IsDebuggerPresent())
         INT3();
     ExitProcess(1);
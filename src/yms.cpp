@@ -1,4 +1,4 @@
-#include "yms.h"
+#include "scstring.h"
 
 static bool IsColorChar(char c)
 {
@@ -3,6 +3,7 @@
 
 #include "game.h"
 #include "offsets.h"
+#include "scstring.h"
 
 inline bool IsInGame()
 { return *bw::is_ingame != 0; }
@@ -43,8 +44,6 @@ inline void ScrambleStruct(void *s, unsigned size)
         ((uint8_t *)s)[i] = val + i;
 }
 
-// retval 0 meinaa invalid / max len reached, 1 meinaa "" stringiä jne
-int Sc_strlen(const char *str, int maxlen1, int maxlen2, bool accept_color_chars, bool accept_control_chars);
 
 namespace Cheats
 {
@@ -0,0 +1,373 @@
+// Benchmarks and fuzzes the command parsing of src/command_table.h.
+//
+// Standalone, only needs the command table and Sc_strlen:
+//     g++ -std=c++14 -O2 -iquote src tools/cmdbench.cpp src/yms.cpp -o cmdbench
+// For fuzzing, building with -fsanitize=address,undefined is recommended, as any read
+// past a command buffer is then reported.
+// Usage:
+//     cmdbench bench [replay_commands.bin] [iterations]
+//     cmdbench fuzz [replay_commands.bin] [iterations] [seed]
+// The input is the raw replay command data written by the `replaycommands` console command.
+// Without input, randomly generated commands are used instead.
+// Exit status is 0 on success, 1 if fuzzing found an error and 2 on other errors.
+
+#include "command_table.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using std::vector;
+
+static const CommandTable command_table;
+
+/// Commands of a single player for a single frame, in the form ProcessCommands receives them.
+struct Turn
+{
+    uint32_t frame;
+    uint8_t player;
+    vector<uint8_t> data;
+};
+
+static bool ReadFile(const char *filename, vector<uint8_t> *out)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return false;
+    }
+    uint8_t buf[0x1000];
+    size_t amount;
+    while ((amount = fread(buf, 1, sizeof buf, file)) != 0)
+        out->insert(out->end(), buf, buf + amount);
+    fclose(file);
+    return true;
+}
+
+/// Replay data is [u32 frame][u8 length][(u8 player, command)...] for each frame.
+/// Splits it to per-player turns.
+static bool ParseReplayCommands(const vector<uint8_t> &data, vector<Turn> *out)
+{
+    size_t pos = 0;
+    while (pos != data.size())
+    {
+        if (data.size() - pos < 5)
+        {
+            fprintf(stderr, "Truncated frame at offset %x\n", (unsigned)pos);
+            return false;
+        }
+        uint32_t frame;
+        memcpy(&frame, data.data() + pos, 4);
+        size_t end = pos + 5 + data[pos + 4];
+        pos += 5;
+        if (end > data.size())
+        {
+            fprintf(stderr, "Truncated frame %u\n", frame);
+            return false;
+        }
+        size_t first_turn = out->size();
+        while (pos < end)
+        {
+            uint8_t player = data[pos];
+            pos += 1;
+            if (pos == end)
+            {
+                fprintf(stderr, "Player %u has no command on frame %u\n", player, frame);
+                return false;
+            }
+            int length = command_table.Length(data.data() + pos, end - pos);
+            if (length <= 0 || pos + length > end)
+            {
+                fprintf(stderr, "Invalid command %02x on frame %u\n", data[pos], frame);
+                return false;
+            }
+            Turn *turn = nullptr;
+            for (size_t i = first_turn; i < out->size(); i++)
+            {
+                if ((*out)[i].player == player)
+                    turn = &(*out)[i];
+            }
+            if (turn == nullptr)
+            {
+                out->emplace_back();
+                turn = &out->back();
+                turn->frame = frame;
+                turn->player = player;
+            }
+            turn->data.insert(turn->data.end(), data.begin() + pos, data.begin() + pos + length);
+            pos += length;
+        }
+    }
+    return true;
+}
+
+/// Xorshift, so that the results are the same everywhere for a given seed
+class Rng
+{
+    public:
+        Rng(uint32_t seed) : state(seed == 0 ? 1 : seed) {}
+        uint32_t Next()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+        uint32_t Rand(uint32_t max) { return Next() % max; }
+
+    private:
+        uint32_t state;
+};
+
+/// Builds a valid command of given id, with random contents.
+static void RandomCommand(Rng *rng, uint8_t id, vector<uint8_t> *out)
+{
+    uint8_t buf[0x100];
+    for (auto &byte : buf)
+        byte = rng->Next();
+    buf[0] = id;
+    int length;
+    switch (id)
+    {
+        case commands::Save: case commands::Load:
+        {
+            int name_length = rng->Rand(0x18);
+            for (int i = 0; i < name_length; i++)
+                buf[5 + i] = 'a' + rng->Rand(26);
+            buf[5 + name_length] = 0;
+            length = 6 + name_length;
+        }
+        break;
+        case commands::Select: case commands::SelectionAdd: case commands::SelectionRemove:
+        {
+            uint32_t count = rng->Rand(13);
+            memcpy(buf + 2, &count, 4);
+            length = 6 + count * 4;
+        }
+        break;
+        default:
+            length = command_table.Length(buf, sizeof buf);
+        break;
+    }
+    out->insert(out->end(), buf, buf + length);
+}
+
+static void RandomTurns(Rng *rng, int count, vector<Turn> *out)
+{
+    static const uint8_t ids[] = {
+#define CMDBENCH_ID(id, length, replay_command, handler) commands::id,
+        SC_GAME_COMMANDS(CMDBENCH_ID)
+#undef CMDBENCH_ID
+    };
+    for (int i = 0; i < count; i++)
+    {
+        out->emplace_back();
+        Turn &turn = out->back();
+        turn.frame = i;
+        turn.player = rng->Rand(8);
+        int command_count = 1 + rng->Rand(4);
+        for (int j = 0; j < command_count; j++)
+            RandomCommand(rng, ids[rng->Rand(sizeof ids)], &turn.data);
+    }
+}
+
+/// Counts how many times each command was handled, so that the dispatch cannot be optimized out.
+static uint32_t handled_counts[0x100];
+static uint32_t handled_bytes;
+
+typedef void (*CommandHandler)(const uint8_t *, bool);
+template <uint8_t id>
+static void CountingHandler(const uint8_t *data, bool replay_process)
+{
+    handled_counts[id] += 1;
+    handled_bytes += data[0];
+}
+
+class CountingHandlers
+{
+    public:
+        CountingHandlers()
+        {
+            for (auto &handler : handlers)
+                handler = nullptr;
+#define CMDBENCH_HANDLER(id, length, replay_command, handler) \
+            handlers[commands::id] = &CountingHandler<commands::id>;
+            SC_GAME_COMMANDS(CMDBENCH_HANDLER)
+#undef CMDBENCH_HANDLER
+        }
+        CommandHandler handlers[0x100];
+};
+
+static const CountingHandlers counting_handlers;
+
+/// Does the same work as ProcessCommands, except for the actual handlers.
+static bool Dispatch(const uint8_t *data, int length)
+{
+    return ForEachCommand(command_table, data, length, [](const uint8_t *cmd, int cmd_length) {
+        CommandHandler handler = counting_handlers.handlers[cmd[0]];
+        if (handler != nullptr)
+            handler(cmd, false);
+    });
+}
+
+static int Bench(const vector<Turn> &turns, int iterations)
+{
+    uint64_t command_count = 0;
+    for (const Turn &turn : turns)
+    {
+        if (!ForEachCommand(command_table, turn.data.data(), turn.data.size(), [&](const uint8_t *, int) {
+            command_count += 1;
+        }))
+        {
+            fprintf(stderr, "Turn of player %u on frame %u is invalid\n", turn.player, turn.frame);
+            return 2;
+        }
+    }
+    if (command_count == 0)
+    {
+        fprintf(stderr, "No commands\n");
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (const Turn &turn : turns)
+            Dispatch(turn.data.data(), turn.data.size());
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    uint64_t total = command_count * iterations;
+    printf("%u turns, %llu commands, %d iterations\n", (unsigned)turns.size(),
+            (unsigned long long)command_count, iterations);
+    printf("%.3f ms total, %.2f ns/command (checksum %x)\n", ns / 1000000.0, ns / total, handled_bytes);
+    return 0;
+}
+
+/// Mutates the turn and checks that every command the parser reports is inside the buffer.
+/// The buffer is allocated to exact size, so sanitizers catch reads past it as well.
+static bool FuzzTurn(Rng *rng, const Turn &turn)
+{
+    vector<uint8_t> data = turn.data;
+    int mutations = 1 + rng->Rand(4);
+    for (int i = 0; i < mutations; i++)
+    {
+        switch (rng->Rand(4))
+        {
+            case 0:
+                if (!data.empty())
+                    data[rng->Rand(data.size())] = rng->Next();
+            break;
+            case 1:
+                if (!data.empty())
+                    data.resize(rng->Rand(data.size()));
+            break;
+            case 2:
+                data.insert(data.begin() + rng->Rand(data.size() + 1), (uint8_t)rng->Next());
+            break;
+            case 3:
+                // Large selection counts are the interesting case for overflows
+                if (data.size() >= 6)
+                {
+                    uint32_t count = rng->Next();
+                    int pos = rng->Rand(data.size() - 5);
+                    data[pos] = commands::Select + rng->Rand(3);
+                    if (data.size() - pos >= 6)
+                        memcpy(data.data() + pos + 2, &count, 4);
+                }
+            break;
+        }
+    }
+
+    uint8_t *buf = (uint8_t *)malloc(data.size() == 0 ? 1 : data.size());
+    memcpy(buf, data.data(), data.size());
+    const uint8_t *buf_end = buf + data.size();
+    bool ok = true;
+    ForEachCommand(command_table, buf, data.size(), [&](const uint8_t *cmd, int length) {
+        if (cmd < buf || length <= 0 || cmd + length > buf_end)
+            ok = false;
+    });
+    if (!ok)
+    {
+        fprintf(stderr, "Command outside buffer, turn of player %u on frame %u:\n", turn.player, turn.frame);
+        for (size_t i = 0; i < data.size(); i++)
+            fprintf(stderr, "%02x%c", data[i], i % 16 == 15 ? '\n' : ' ');
+        fprintf(stderr, "\n");
+    }
+    free(buf);
+    return ok;
+}
+
+static int Fuzz(const vector<Turn> &turns, int iterations, uint32_t seed)
+{
+    Rng rng(seed);
+    for (int i = 0; i < iterations; i++)
+    {
+        if (!FuzzTurn(&rng, turns[rng.Rand(turns.size())]))
+        {
+            fprintf(stderr, "Failed at iteration %d, seed %u\n", i, seed);
+            return 1;
+        }
+    }
+    printf("%d iterations ok, seed %u\n", iterations, seed);
+    return 0;
+}
+
+static void Usage()
+{
+    fprintf(stderr, "Usage: cmdbench bench [replay_commands.bin] [iterations]\n");
+    fprintf(stderr, "       cmdbench fuzz [replay_commands.bin] [iterations] [seed]\n");
+}
+
+int main(int argc, const char **argv)
+{
+    if (argc < 2)
+    {
+        Usage();
+        return 2;
+    }
+    bool bench = strcmp(argv[1], "bench") == 0;
+    if (!bench && strcmp(argv[1], "fuzz") != 0)
+    {
+        Usage();
+        return 2;
+    }
+    // A file name is anything that is not a number
+    int arg = 2;
+    const char *filename = nullptr;
+    if (argc > arg && strtoul(argv[arg], nullptr, 0) == 0 && strcmp(argv[arg], "0") != 0)
+        filename = argv[arg++];
+    int iterations = argc > arg ? atoi(argv[arg++]) : (bench ? 100 : 1000000);
+    uint32_t seed = argc > arg ? strtoul(argv[arg++], nullptr, 0) : 1;
+    if (iterations <= 0)
+    {
+        Usage();
+        return 2;
+    }
+
+    vector<Turn> turns;
+    if (filename != nullptr)
+    {
+        vector<uint8_t> data;
+        if (!ReadFile(filename, &data) || !ParseReplayCommands(data, &turns))
+            return 2;
+    }
+    else
+    {
+        Rng rng(seed);
+        RandomTurns(&rng, 10000, &turns);
+    }
+    if (turns.empty())
+    {
+        fprintf(stderr, "No commands\n");
+        return 2;
+    }
+
+    if (bench)
+        return Bench(turns, iterations);
+    else
+        return Fuzz(turns, iterations, seed);
+}
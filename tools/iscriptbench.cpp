@@ -0,0 +1,542 @@
+// Checks that the precompiled iscript (src/iscript_decode.h) executes the same commands as
+// decoding each command when it is executed, and that its header tables agree with scanning
+// iscript.bin. Measures both.
+//
+// Standalone, only needs the iscript decoder:
+//     g++ -std=c++14 -O2 -iquote src tools/iscriptbench.cpp src/iscript_decode.cpp -o iscriptbench
+// Usage:
+//     iscriptbench [iscript.bin] [frames] [images]
+// Without iscript.bin (extracted from StarDat.mpq), a generated script is used instead.
+// The command handlers are stubs which only follow jumps and waits, with a seeded rng
+// for the conditional jumps, so both interpreters have to execute the exact same commands.
+// Exit status is 0 if the interpreters match, 1 if they differ and 2 on other errors.
+
+#include "iscript_decode.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using std::vector;
+using Iscript::Command;
+using Iscript::CompiledScript;
+using Iscript::OffsetSize;
+
+/// Xorshift, so that the results are the same everywhere
+class Rng
+{
+    public:
+        Rng(uint32_t seed) : state(seed == 0 ? 1 : seed) {}
+        uint32_t Next()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+        uint32_t Rand(uint32_t max) { return Next() % max; }
+
+    private:
+        uint32_t state;
+};
+
+/// Equivalent of Iscript::Script, along with the state the stub handlers need.
+struct TestScript
+{
+    OffsetSize pos;
+    OffsetSize return_pos;
+    uint8_t wait;
+    bool ended;
+    Rng rng;
+    /// Hash of every executed command, to compare the interpreters
+    uint32_t trace;
+    uint32_t command_count;
+
+    TestScript(OffsetSize pos, uint32_t seed) : pos(pos), return_pos(0), wait(0), ended(false),
+        rng(seed), trace(0), command_count(0) {}
+};
+
+static uint32_t Mix(uint32_t hash, uint32_t value)
+{
+    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+/// Scripts that execute this many commands without waiting are stopped.
+static const int CommandLimit = 256;
+
+/// Returns true if the script stops for this frame.
+static bool HandleCommand(const uint8_t *iscript, TestScript *script, const Command &cmd)
+{
+    using namespace Iscript::Opcode;
+    script->command_count += 1;
+    uint32_t hash = Mix(script->trace, cmd.opcode);
+    hash = Mix(hash, cmd.pos);
+    hash = Mix(hash, cmd.point.x);
+    hash = Mix(hash, cmd.point.y);
+    if (cmd.opcode == PlaySndRand || cmd.opcode == AttackMelee)
+        hash = Mix(hash, cmd.data - iscript);
+    else
+        hash = Mix(hash, cmd.val);
+    script->trace = Mix(hash, script->pos);
+
+    switch (cmd.opcode)
+    {
+        case Wait:
+            script->wait = cmd.val;
+            return true;
+        case WaitRand:
+            script->wait = cmd.val1() + script->rng.Rand(abs(cmd.val2() - cmd.val1()) + 1);
+            return true;
+        case Goto:
+            script->pos = cmd.pos;
+        break;
+        case Call:
+            script->return_pos = script->pos;
+            script->pos = cmd.pos;
+        break;
+        case Return:
+            script->pos = script->return_pos;
+        break;
+        case RandCondJmp: case PwrupCondJmp: case LiftoffCondJmp:
+        case TrgtRangeCondJmp: case TrgtArcCondJmp: case CurDirectCondJmp:
+            if (script->rng.Next() & 0x100)
+                script->pos = cmd.pos;
+        break;
+        case End:
+            script->ended = true;
+            return true;
+        default:
+            if (cmd.opcode > DoGrdDamage)
+            {
+                script->ended = true;
+                return true;
+            }
+        break;
+    }
+    return false;
+}
+
+/// How Script::ProgressFrame worked before precompiling
+static void ProgressFrame_Decode(const uint8_t *iscript, TestScript *script)
+{
+    if (script->ended || script->wait-- != 0)
+        return;
+    for (int i = 0; i < CommandLimit; i++)
+    {
+        const Command cmd = Iscript::Decode(iscript + script->pos);
+        script->pos += cmd.Size();
+        if (HandleCommand(iscript, script, cmd))
+            return;
+    }
+}
+
+static void ProgressFrame_Compiled(const uint8_t *iscript, const CompiledScript &compiled, TestScript *script)
+{
+    if (script->ended || script->wait-- != 0)
+        return;
+    for (int i = 0; i < CommandLimit; i++)
+    {
+        bool stop;
+        const CompiledScript::Entry *entry = compiled.Find(script->pos);
+        if (entry != nullptr)
+        {
+            script->pos = entry->next;
+            stop = HandleCommand(iscript, script, entry->cmd);
+        }
+        else
+        {
+            const Command cmd = Iscript::Decode(iscript + script->pos);
+            script->pos += cmd.Size();
+            stop = HandleCommand(iscript, script, cmd);
+        }
+        if (stop)
+            return;
+    }
+}
+
+static bool ReadFile(const char *filename, vector<uint8_t> *out)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return false;
+    }
+    uint8_t buf[0x1000];
+    size_t amount;
+    while ((amount = fread(buf, 1, sizeof buf, file)) != 0)
+        out->insert(out->end(), buf, buf + amount);
+    fclose(file);
+    return true;
+}
+
+class ScriptWriter
+{
+    public:
+        ScriptWriter(vector<uint8_t> *out) : out(out) {}
+        uint32_t Pos() const { return out->size(); }
+        void U8(uint8_t val) { out->emplace_back(val); }
+        void U16(uint16_t val) { U8(val & 0xff); U8(val >> 8); }
+        void U32(uint32_t val) { U16(val & 0xffff); U16(val >> 16); }
+        void SetU16(uint32_t pos, uint16_t val) { (*out)[pos] = val & 0xff; (*out)[pos + 1] = val >> 8; }
+
+        /// Writes a command with random parameters, and returns its position
+        uint32_t Command(Rng *rng, uint8_t opcode)
+        {
+            uint32_t pos = Pos();
+            U8(opcode);
+            if (opcode == Iscript::Opcode::PlaySndRand || opcode == Iscript::Opcode::AttackMelee)
+            {
+                int count = 1 + rng->Rand(3);
+                U8(count);
+                for (int i = 0; i < count; i++)
+                    U16(rng->Next());
+            }
+            else
+            {
+                int length = Iscript::Command(opcode).ParamsLength();
+                for (int i = 0; i < length; i++)
+                    U8(rng->Next());
+            }
+            return pos;
+        }
+
+    private:
+        vector<uint8_t> *out;
+};
+
+/// Offset of the jump target in a conditional jump, or 0 if the opcode isn't one
+static int JumpParamOffset(uint8_t opcode)
+{
+    using namespace Iscript::Opcode;
+    switch (opcode)
+    {
+        case PwrupCondJmp: case LiftoffCondJmp: return 1;
+        case RandCondJmp: return 2;
+        case TrgtRangeCondJmp: return 3;
+        case TrgtArcCondJmp: case CurDirectCondJmp: return 5;
+        default: return 0;
+    }
+}
+
+/// Generates a script with headers of type 12 (14 animations), which loop or end.
+/// Animations may call a shared subroutine and jump back to their beginning.
+static void GenerateIscript(uint32_t seed, vector<uint8_t> *out)
+{
+    using namespace Iscript::Opcode;
+    Rng rng(seed);
+    ScriptWriter writer(out);
+    // Small enough to fit in the 16-bit positions
+    const int header_count = 120;
+    const int anim_count = 14;
+    writer.U32(0);
+
+    vector<uint32_t> headers;
+    for (int i = 0; i < header_count; i++)
+    {
+        headers.emplace_back(writer.Pos());
+        writer.U32(0x45504353); // "SCPE"
+        writer.U32(12);
+        for (int j = 0; j < anim_count; j++)
+            writer.U16(0);
+    }
+
+    uint32_t subroutine = writer.Pos();
+    for (int i = 0; i < 4; i++)
+        writer.Command(&rng, PlayFram);
+    writer.Command(&rng, Return);
+
+    for (uint32_t header : headers)
+    {
+        for (int anim = 0; anim < anim_count; anim++)
+        {
+            if (rng.Rand(4) == 0)
+                continue;
+            uint32_t anim_pos = writer.Pos();
+            writer.SetU16(header + 8 + anim * 2, anim_pos);
+            int length = 2 + rng.Rand(20);
+            for (int i = 0; i < length; i++)
+            {
+                uint8_t opcode;
+                switch (rng.Rand(8))
+                {
+                    case 0:
+                        writer.U8(Wait);
+                        writer.U8(rng.Rand(4));
+                    break;
+                    case 1:
+                        writer.Command(&rng, WaitRand);
+                    break;
+                    case 2:
+                        writer.U8(Call);
+                        writer.U16(subroutine);
+                    break;
+                    case 3:
+                    {
+                        static const uint8_t jumps[] = {
+                            RandCondJmp, PwrupCondJmp, LiftoffCondJmp,
+                            TrgtRangeCondJmp, TrgtArcCondJmp, CurDirectCondJmp,
+                        };
+                        opcode = jumps[rng.Rand(sizeof jumps)];
+                        uint32_t pos = writer.Command(&rng, opcode);
+                        writer.SetU16(pos + JumpParamOffset(opcode), anim_pos);
+                    }
+                    break;
+                    default:
+                        do {
+                            opcode = rng.Rand(DoGrdDamage + 1);
+                        } while (opcode == Goto || opcode == Call || opcode == Return ||
+                                opcode == End || opcode == Wait || JumpParamOffset(opcode) != 0);
+                        writer.Command(&rng, opcode);
+                    break;
+                }
+            }
+            if (rng.Rand(3) == 0)
+            {
+                writer.U8(End);
+            }
+            else
+            {
+                writer.U8(Wait);
+                writer.U8(1);
+                writer.U8(Goto);
+                writer.U16(anim_pos);
+            }
+        }
+    }
+
+    uint32_t header_table = writer.Pos();
+    for (uint32_t i = 0; i < headers.size(); i++)
+    {
+        writer.U16(i);
+        writer.U16(headers[i]);
+    }
+    writer.U16(0xffff);
+    writer.U16(0);
+    // Padding, so that decoding the last command can't read past the buffer
+    for (int i = 0; i < 8; i++)
+        writer.U8(0);
+    memcpy(out->data(), &header_table, 4);
+}
+
+/// How Script::Initialize found headers before they were compiled
+static bool FindHeader_Scan(const uint8_t *iscript, int header_id, OffsetSize *out)
+{
+    uint32_t header_offset = *(const uint32_t *)iscript;
+    const OffsetSize *headers = (const OffsetSize *)(iscript + header_offset);
+    while (headers[0] != 0xffff)
+    {
+        if (headers[0] == header_id)
+        {
+            *out = headers[1];
+            return true;
+        }
+        headers += 2;
+    }
+    return false;
+}
+
+/// How Image::SetIscriptAnimation found animations before they were compiled
+static OffsetSize AnimationPos_Read(const uint8_t *iscript, OffsetSize header, int anim)
+{
+    const uint8_t *pos = iscript + header;
+    if (*(const int32_t *)(pos + 4) >= anim)
+        return *(const OffsetSize *)(pos + 8 + anim * sizeof(OffsetSize));
+    return 0;
+}
+
+/// Compares header lookups, and times them with `lookups` random header ids.
+/// Animations may only differ if the compiled one was rejected as invalid.
+static bool CheckHeaders(const uint8_t *iscript, const CompiledScript &compiled, int lookups)
+{
+    using namespace std::chrono;
+    int max_id = 0;
+    uint32_t header_offset = *(const uint32_t *)iscript;
+    for (const OffsetSize *headers = (const OffsetSize *)(iscript + header_offset); headers[0] != 0xffff; headers += 2)
+        max_id = std::max(max_id, (int)headers[0]);
+
+    for (int id = 0; id <= max_id + 1; id++)
+    {
+        OffsetSize scan_pos = 0, compiled_pos = 0;
+        bool scan_found = FindHeader_Scan(iscript, id, &scan_pos);
+        bool compiled_found = compiled.FindHeader(id, &compiled_pos);
+        if (scan_found != compiled_found || scan_pos != compiled_pos)
+        {
+            fprintf(stderr, "Header %x differs: %d %x vs %d %x\n", id, scan_found, scan_pos,
+                    compiled_found, compiled_pos);
+            return false;
+        }
+        if (!scan_found)
+            continue;
+        for (int anim = 0; anim < 0x1c; anim++)
+        {
+            OffsetSize read = AnimationPos_Read(iscript, scan_pos, anim);
+            OffsetSize compiled_anim = compiled.AnimationPos(compiled_pos, anim);
+            if (compiled_anim != 0 && compiled_anim != read)
+            {
+                fprintf(stderr, "Header %x animation %x differs: %x vs %x\n", id, anim, read, compiled_anim);
+                return false;
+            }
+        }
+    }
+
+    Rng rng(1);
+    vector<int> ids;
+    for (int i = 0; i < lookups; i++)
+        ids.emplace_back(rng.Rand(max_id + 1));
+    uint32_t checksum = 0;
+    auto scan_start = steady_clock::now();
+    for (int id : ids)
+    {
+        OffsetSize pos = 0;
+        FindHeader_Scan(iscript, id, &pos);
+        checksum += pos;
+    }
+    auto scan_end = steady_clock::now();
+    for (int id : ids)
+    {
+        OffsetSize pos = 0;
+        compiled.FindHeader(id, &pos);
+        checksum -= pos;
+    }
+    auto compiled_end = steady_clock::now();
+    if (checksum != 0)
+    {
+        fprintf(stderr, "Header lookups differ\n");
+        return false;
+    }
+    typedef duration<double, std::nano> ns;
+    printf("%u headers, %d lookups: scan %.2f ns/lookup, compiled %.2f ns/lookup\n",
+            compiled.HeaderCount(), lookups, ns(scan_end - scan_start).count() / lookups,
+            ns(compiled_end - scan_end).count() / lookups);
+    return true;
+}
+
+/// Creates one script for each animation, repeated until there are `count` of them.
+static bool CreateScripts(const vector<uint8_t> &iscript, int count, vector<TestScript> *out)
+{
+    vector<OffsetSize> animations;
+    uint32_t header_offset;
+    memcpy(&header_offset, iscript.data(), 4);
+    for (uint32_t pos = header_offset; pos + 4 <= iscript.size(); pos += 4)
+    {
+        OffsetSize id, offset;
+        memcpy(&id, iscript.data() + pos, 2);
+        memcpy(&offset, iscript.data() + pos + 2, 2);
+        if (id == 0xffff)
+            break;
+        if ((uint32_t)offset + 8 > iscript.size())
+            continue;
+        int anims = iscript[offset + 4] + 1;
+        for (int i = 0; i < anims && offset + 8 + i * 2 + 2 <= (int)iscript.size(); i++)
+        {
+            OffsetSize anim;
+            memcpy(&anim, iscript.data() + offset + 8 + i * 2, 2);
+            if (anim != 0)
+                animations.emplace_back(anim);
+        }
+    }
+    if (animations.empty())
+    {
+        fprintf(stderr, "No animations in the iscript\n");
+        return false;
+    }
+    for (int i = 0; i < count; i++)
+        out->emplace_back(animations[i % animations.size()], i + 1);
+    return true;
+}
+
+int main(int argc, const char **argv)
+{
+    int arg = 1;
+    const char *filename = nullptr;
+    if (argc > arg && atoi(argv[arg]) == 0)
+        filename = argv[arg++];
+    int frames = argc > arg ? atoi(argv[arg++]) : 2000;
+    int image_count = argc > arg ? atoi(argv[arg++]) : 20000;
+    if (frames <= 0 || image_count <= 0)
+    {
+        fprintf(stderr, "Usage: iscriptbench [iscript.bin] [frames] [images]\n");
+        return 2;
+    }
+
+    vector<uint8_t> iscript;
+    if (filename != nullptr)
+    {
+        if (!ReadFile(filename, &iscript))
+            return 2;
+        // Reading a command at the end of the file could go past the buffer otherwise
+        iscript.resize(iscript.size() + 8);
+    }
+    else
+    {
+        GenerateIscript(1, &iscript);
+    }
+    if (iscript.size() < 4)
+    {
+        fprintf(stderr, "Invalid iscript\n");
+        return 2;
+    }
+
+    vector<TestScript> decode_scripts;
+    if (!CreateScripts(iscript, image_count, &decode_scripts))
+        return 2;
+    vector<TestScript> compiled_scripts = decode_scripts;
+
+    auto compile_start = std::chrono::steady_clock::now();
+    CompiledScript compiled;
+    compiled.Compile(iscript.data());
+    auto compile_end = std::chrono::steady_clock::now();
+    for (const auto &error : compiled.Errors())
+        printf("Compile error: %s\n", error.c_str());
+    if (!CheckHeaders(iscript.data(), compiled, 1000000))
+        return 1;
+
+    auto decode_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        for (TestScript &script : decode_scripts)
+            ProgressFrame_Decode(iscript.data(), &script);
+    }
+    auto decode_end = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        for (TestScript &script : compiled_scripts)
+            ProgressFrame_Compiled(iscript.data(), compiled, &script);
+    }
+    auto compiled_end = std::chrono::steady_clock::now();
+
+    uint64_t command_count = 0;
+    for (size_t i = 0; i < decode_scripts.size(); i++)
+    {
+        const TestScript &a = decode_scripts[i];
+        const TestScript &b = compiled_scripts[i];
+        if (a.trace != b.trace || a.command_count != b.command_count || a.pos != b.pos)
+        {
+            fprintf(stderr, "Image %u differs: %u commands, pos %x vs %u commands, pos %x\n",
+                    (unsigned)i, a.command_count, a.pos, b.command_count, b.pos);
+            return 1;
+        }
+        command_count += a.command_count;
+    }
+    if (command_count == 0)
+    {
+        fprintf(stderr, "No commands were executed\n");
+        return 2;
+    }
+
+    typedef std::chrono::duration<double, std::nano> ns;
+    double compile_ns = ns(compile_end - compile_start).count();
+    double decode_ns = ns(decode_end - decode_start).count();
+    double compiled_ns = ns(compiled_end - decode_end).count();
+    printf("Compiled %u commands in %.3f ms\n", compiled.CommandCount(), compile_ns / 1000000.0);
+    printf("%u images, %d frames, %llu commands, both interpreters match\n",
+            (unsigned)decode_scripts.size(), frames, (unsigned long long)command_count);
+    printf("Decode:   %.3f ms, %.2f ns/command\n", decode_ns / 1000000.0, decode_ns / command_count);
+    printf("Compiled: %.3f ms, %.2f ns/command\n", compiled_ns / 1000000.0, compiled_ns / command_count);
+    return 0;
+}
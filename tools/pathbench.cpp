@@ -0,0 +1,274 @@
+// Benchmarks the region pathfinder of src/region_path.h, with and without the path cache,
+// and with the cache using flow fields.
+//
+// Standalone, only needs the pathfinder:
+//     g++ -std=c++14 -O2 -iquote src tools/pathbench.cpp src/region_path.cpp -o pathbench
+// Usage:
+//     pathbench [pathing.bin] [frames] [groups] [group size] [seed]
+// The input is the region graph written by the `pathingdata` console command.
+// Without input, a generated grid of regions is used instead.
+// Every frame, `groups` random destinations are chosen, and `group size` units from random
+// regions near each other path there, which is roughly what a group move order does.
+// The paths found with the cache are checked to be identical to uncached searches, and the
+// paths from flow fields to have the same cost.
+// Exit status is 0 on success, 1 if the paths differ and 2 on other errors.
+
+#include "region_path.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using std::vector;
+using Pathing::RegionGraph;
+
+/// Xorshift, so that the results are the same everywhere for a given seed
+class Rng
+{
+    public:
+        Rng(uint32_t seed) : state(seed == 0 ? 1 : seed) {}
+        uint32_t Next()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+        uint32_t Rand(uint32_t max) { return Next() % max; }
+
+    private:
+        uint32_t state;
+};
+
+/// Grid of 64x64 regions with some of them blocked, so that there are walls to path around.
+/// Groups are the connected areas, like they are in the game.
+static void GenerateGraph(Rng *rng, RegionGraph *out)
+{
+    const int size = 64;
+    const int region_size = 32;
+    vector<bool> blocked(size * size);
+    for (int i = 0; i < size * size; i++)
+        blocked[i] = rng->Rand(5) == 0;
+    auto neighbours_of = [&](int region, uint16_t *out_neighbours) {
+        static const int offsets[4][2] = { { 0, -1 }, { 1, 0 }, { 0, 1 }, { -1, 0 } };
+        int x = region % size, y = region / size;
+        int count = 0;
+        if (blocked[region])
+            return count;
+        for (const auto &offset : offsets)
+        {
+            int nx = x + offset[0], ny = y + offset[1];
+            if (nx >= 0 && ny >= 0 && nx < size && ny < size && !blocked[ny * size + nx])
+                out_neighbours[count++] = ny * size + nx;
+        }
+        return count;
+    };
+
+    const uint16_t NoGroup = 0xffff;
+    vector<uint16_t> groups(size * size, NoGroup);
+    uint16_t next_group = 0;
+    vector<int> stack;
+    for (int i = 0; i < size * size; i++)
+    {
+        if (groups[i] != NoGroup)
+            continue;
+        groups[i] = next_group;
+        stack.push_back(i);
+        while (!stack.empty())
+        {
+            uint16_t neighbours[4];
+            int count = neighbours_of(stack.back(), neighbours);
+            stack.pop_back();
+            for (int j = 0; j < count; j++)
+            {
+                if (groups[neighbours[j]] == NoGroup)
+                {
+                    groups[neighbours[j]] = next_group;
+                    stack.push_back(neighbours[j]);
+                }
+            }
+        }
+        next_group += 1;
+    }
+
+    for (int i = 0; i < size * size; i++)
+    {
+        uint16_t neighbours[4];
+        int count = neighbours_of(i, neighbours);
+        out->AddRegion((i % size) * region_size + region_size / 2, (i / size) * region_size + region_size / 2,
+                groups[i], neighbours, count);
+    }
+}
+
+struct Query
+{
+    uint16_t start;
+    uint16_t goal;
+};
+
+/// Picks regions close to each other by walking a few steps from a random region
+static uint16_t NearbyRegion(Rng *rng, const RegionGraph &graph, uint16_t region)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        const RegionGraph::Node &node = graph.Region(region);
+        if (node.neighbour_count == 0)
+            break;
+        region = graph.Neighbours(node)[rng->Rand(node.neighbour_count)];
+    }
+    return region;
+}
+
+/// Destinations are picked from a small set, as armies tend to be sent to the same few places
+static void GenerateFrames(Rng *rng, const RegionGraph &graph, int frames, int groups, int group_size,
+        vector<vector<Query>> *out)
+{
+    uint16_t destinations[16];
+    for (auto &destination : destinations)
+        destination = rng->Rand(graph.RegionCount());
+    for (int i = 0; i < frames; i++)
+    {
+        out->emplace_back();
+        for (int j = 0; j < groups; j++)
+        {
+            uint16_t goal = destinations[rng->Rand(16)];
+            uint16_t group_start = rng->Rand(graph.RegionCount());
+            for (int k = 0; k < group_size; k++)
+                out->back().push_back(Query { NearbyRegion(rng, graph, group_start), goal });
+        }
+    }
+}
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static void Usage()
+{
+    fprintf(stderr, "Usage: pathbench [pathing.bin] [frames] [groups] [group size] [seed]\n");
+}
+
+int main(int argc, const char **argv)
+{
+    // A file name is anything that is not a number
+    int arg = 1;
+    const char *filename = nullptr;
+    if (argc > arg && strtoul(argv[arg], nullptr, 0) == 0 && strcmp(argv[arg], "0") != 0)
+        filename = argv[arg++];
+    int frames = argc > arg ? atoi(argv[arg++]) : 1000;
+    int groups = argc > arg ? atoi(argv[arg++]) : 4;
+    int group_size = argc > arg ? atoi(argv[arg++]) : 12;
+    uint32_t seed = argc > arg ? strtoul(argv[arg++], nullptr, 0) : 1;
+    if (frames <= 0 || groups <= 0 || group_size <= 0)
+    {
+        Usage();
+        return 2;
+    }
+
+    Rng rng(seed);
+    RegionGraph graph;
+    if (filename != nullptr)
+    {
+        FILE *file = fopen(filename, "rb");
+        if (file == nullptr)
+        {
+            fprintf(stderr, "Could not open %s\n", filename);
+            return 2;
+        }
+        bool ok = graph.Read(file);
+        fclose(file);
+        if (!ok)
+        {
+            fprintf(stderr, "%s is not valid pathing data\n", filename);
+            return 2;
+        }
+    }
+    else
+    {
+        GenerateGraph(&rng, &graph);
+    }
+    if (graph.RegionCount() == 0)
+    {
+        fprintf(stderr, "No regions\n");
+        return 2;
+    }
+
+    vector<vector<Query>> queries;
+    GenerateFrames(&rng, graph, frames, groups, group_size, &queries);
+
+    Pathing::RegionPathfinder pathfinder;
+    vector<uint16_t> path;
+    uint64_t found = 0;
+    uint64_t total_length = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &frame : queries)
+    {
+        for (const Query &query : frame)
+        {
+            if (pathfinder.FindPath(graph, query.start, query.goal, &path))
+            {
+                found += 1;
+                total_length += path.size();
+            }
+        }
+    }
+    double uncached_ms = ElapsedMs(start);
+    uint64_t uncached_visited = pathfinder.VisitedNodes();
+
+    uint64_t query_count = (uint64_t)frames * groups * group_size;
+    printf("%u regions, %llu searches, %llu found, average length %.1f\n", graph.RegionCount(),
+            (unsigned long long)query_count, (unsigned long long)found,
+            found == 0 ? 0.0 : (double)total_length / found);
+    printf("Uncached:    %.3f ms, %.2f us/search, %.1f regions visited/search\n", uncached_ms,
+            uncached_ms * 1000.0 / query_count, (double)uncached_visited / query_count);
+
+    for (bool flow_fields : { false, true })
+    {
+        Pathing::RegionPathfinder cached_pathfinder;
+        Pathing::RegionPathCache cache;
+        cache.SetUseFlowFields(flow_fields);
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < queries.size(); i++)
+        {
+            for (const Query &query : queries[i])
+                cache.FindPath(graph, &cached_pathfinder, query.start, query.goal, i + 1);
+        }
+        double cached_ms = ElapsedMs(start);
+        printf("%s %.3f ms, %.2f us/search, %u hits, %u misses, %u from flow fields\n",
+                flow_fields ? "Flow fields:" : "Cached:     ", cached_ms, cached_ms * 1000.0 / query_count,
+                cache.Hits(), cache.Misses(), cache.FlowFieldPaths());
+
+        // Each cached path has to be what a search would have found. Flow fields may
+        // choose a different path of same cost.
+        cache.Clear();
+        for (uint32_t i = 0; i < queries.size(); i++)
+        {
+            for (const Query &query : queries[i])
+            {
+                const vector<uint16_t> *result = cache.FindPath(graph, &cached_pathfinder, query.start, query.goal, i + 1);
+                bool ok = pathfinder.FindPath(graph, query.start, query.goal, &path);
+                bool same;
+                if (ok != (result != nullptr))
+                    same = false;
+                else if (!ok)
+                    same = true;
+                else if (flow_fields)
+                    same = result->front() == path.front() && result->back() == path.back() &&
+                        graph.PathCost(*result) == graph.PathCost(path);
+                else
+                    same = *result == path;
+                if (!same)
+                {
+                    fprintf(stderr, "%s paths from %u to %u differ on frame %u\n",
+                            flow_fields ? "Flow field" : "Cached", query.start, query.goal, i);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
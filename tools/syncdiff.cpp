@@ -0,0 +1,323 @@
+// Compares two binary sync dumps (dump\sync.bin written by sync test builds) and reports
+// the first frame where they diverge, along with the first differing field.
+//
+// Standalone, only needs src/sync_dump.h:
+//     g++ -std=c++14 -O2 -iquote src tools/syncdiff.cpp -o syncdiff
+// Usage:
+//     syncdiff [-a] first.bin second.bin
+//     -a  List every difference of the diverging frame instead of just the first one
+// Exit status is 0 if the dumps match, 1 if they diverge and 2 on errors.
+
+#include "sync_dump.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+struct Frame
+{
+    SyncDump::FrameHeader header;
+    vector<uint8_t> data;
+};
+
+class DumpFile
+{
+    public:
+        DumpFile(const char *filename) : name(filename), file(fopen(filename, "rb")) {}
+        ~DumpFile() { if (file != nullptr) fclose(file); }
+
+        bool Open()
+        {
+            if (file == nullptr)
+            {
+                fprintf(stderr, "Could not open %s\n", name);
+                return false;
+            }
+            SyncDump::FileHeader header;
+            if (fread(&header, sizeof header, 1, file) != 1 || header.magic != SyncDump::FileMagic)
+            {
+                fprintf(stderr, "%s is not a sync dump\n", name);
+                return false;
+            }
+            if (header.version != SyncDump::Version)
+            {
+                fprintf(stderr, "%s has version %u, expected %u\n", name, header.version, SyncDump::Version);
+                return false;
+            }
+            return true;
+        }
+
+        /// Returns false at end of file. A truncated frame (the game crashed while writing)
+        /// is treated as the end of file.
+        bool Next(Frame *out)
+        {
+            if (fread(&out->header, sizeof out->header, 1, file) != 1)
+                return false;
+            if (out->header.magic != SyncDump::FrameMagic)
+            {
+                fprintf(stderr, "%s: corrupted frame after frame %u\n", name, last_frame);
+                return false;
+            }
+            out->data.resize(out->header.size);
+            if (out->header.size != 0 && fread(out->data.data(), 1, out->header.size, file) != out->header.size)
+                return false;
+            last_frame = out->header.frame;
+            return true;
+        }
+
+        const char *name;
+
+    private:
+        FILE *file;
+        uint32_t last_frame = 0;
+};
+
+class Differ
+{
+    public:
+        Differ(bool list_all) : list_all(list_all), difference_count(0) {}
+
+        /// Returns true if the frames differ.
+        bool CompareFrames(const Frame &a, const Frame &b)
+        {
+            frame = a.header.frame;
+            difference_count = 0;
+            const auto &ha = a.header, &hb = b.header;
+            CompareValue("header", "rng_seed", ha.rng_seed, hb.rng_seed);
+            CompareValue("header", "trigger_cycle_count", ha.trigger_cycle_count, hb.trigger_cycle_count);
+            CompareValue("header", "countdown_timer", ha.countdown_timer, hb.countdown_timer);
+            for (int i = 0; i < 8; i++)
+            {
+                char field[32];
+                snprintf(field, sizeof field, "player_waits[%d]", i);
+                CompareValue("header", field, ha.player_waits[i], hb.player_waits[i]);
+            }
+
+            Section sa(a), sb(b);
+            if (!sa.Valid() || !sb.Valid())
+            {
+                fprintf(stderr, "Frame %u: record counts do not match the frame size\n", frame);
+                exit(2);
+            }
+            CompareKeyed("unit", sa.units, sb.units, ha.unit_count, hb.unit_count,
+                    sizeof(SyncDump::Unit), SyncDump::unit_fields, Count(SyncDump::unit_fields));
+            CompareKeyed("path", sa.paths, sb.paths, ha.path_count, hb.path_count,
+                    sizeof(SyncDump::Path), SyncDump::path_fields, Count(SyncDump::path_fields));
+            CompareIndexed("bullet", sa.bullets, sb.bullets, ha.bullet_count, hb.bullet_count,
+                    sizeof(SyncDump::Bullet), SyncDump::bullet_fields, Count(SyncDump::bullet_fields));
+            CompareIndexed("ai region", sa.ai_regions, sb.ai_regions, ha.ai_region_count, hb.ai_region_count,
+                    sizeof(SyncDump::AiRegion), SyncDump::ai_region_fields, Count(SyncDump::ai_region_fields));
+            CompareIndexed("ai request", sa.ai_requests, sb.ai_requests, ha.ai_request_count, hb.ai_request_count,
+                    sizeof(SyncDump::AiRequest), SyncDump::ai_request_fields, Count(SyncDump::ai_request_fields));
+            return difference_count != 0;
+        }
+
+        int DifferenceCount() const { return difference_count; }
+
+    private:
+        /// Splits frame data to the record arrays
+        struct Section
+        {
+            Section(const Frame &frame)
+            {
+                const auto &h = frame.header;
+                size_t pos = 0;
+                units = Take(frame, &pos, h.unit_count * sizeof(SyncDump::Unit));
+                paths = Take(frame, &pos, h.path_count * sizeof(SyncDump::Path));
+                bullets = Take(frame, &pos, h.bullet_count * sizeof(SyncDump::Bullet));
+                ai_regions = Take(frame, &pos, h.ai_region_count * sizeof(SyncDump::AiRegion));
+                ai_requests = Take(frame, &pos, h.ai_request_count * sizeof(SyncDump::AiRequest));
+                valid = pos == frame.data.size();
+            }
+
+            bool Valid() const { return valid; }
+
+            const uint8_t *units;
+            const uint8_t *paths;
+            const uint8_t *bullets;
+            const uint8_t *ai_regions;
+            const uint8_t *ai_requests;
+
+            private:
+                const uint8_t *Take(const Frame &frame, size_t *pos, size_t size)
+                {
+                    if (*pos + size > frame.data.size())
+                    {
+                        *pos = frame.data.size() + 1;
+                        return nullptr;
+                    }
+                    const uint8_t *ret = frame.data.data() + *pos;
+                    *pos += size;
+                    return ret;
+                }
+
+                bool valid;
+        };
+
+        template <size_t N>
+        static size_t Count(const SyncDump::Field (&)[N]) { return N; }
+
+        static uint32_t ReadField(const uint8_t *record, const SyncDump::Field &field)
+        {
+            uint32_t value = 0;
+            memcpy(&value, record + field.offset, field.size);
+            return value;
+        }
+
+        void Report(const string &text)
+        {
+            if (difference_count == 0)
+                printf("First difference at frame %u\n", frame);
+            difference_count++;
+            if (difference_count == 1 || list_all)
+                printf("    %s\n", text.c_str());
+        }
+
+        void CompareValue(const char *object, const char *field, uint32_t a, uint32_t b)
+        {
+            if (a == b || (difference_count != 0 && !list_all))
+                return;
+            char buf[256];
+            snprintf(buf, sizeof buf, "%s %s: %08x != %08x", object, field, a, b);
+            Report(buf);
+        }
+
+        void CompareRecords(const string &object, const uint8_t *a, const uint8_t *b,
+                const SyncDump::Field *fields, size_t field_count)
+        {
+            for (size_t i = 0; i < field_count; i++)
+            {
+                if (difference_count != 0 && !list_all)
+                    return;
+                uint32_t va = ReadField(a, fields[i]), vb = ReadField(b, fields[i]);
+                if (va != vb)
+                {
+                    char buf[256];
+                    snprintf(buf, sizeof buf, "%s %s: %x != %x", object.c_str(), fields[i].name, va, vb);
+                    Report(buf);
+                }
+            }
+        }
+
+        /// Records which begin with an unit lookup id, sorted by it
+        void CompareKeyed(const char *type, const uint8_t *a, const uint8_t *b, uint32_t count_a,
+                uint32_t count_b, size_t size, const SyncDump::Field *fields, size_t field_count)
+        {
+            uint32_t pos_a = 0, pos_b = 0;
+            char object[64];
+            while (pos_a < count_a || pos_b < count_b)
+            {
+                if (difference_count != 0 && !list_all)
+                    return;
+                const uint8_t *rec_a = pos_a < count_a ? a + pos_a * size : nullptr;
+                const uint8_t *rec_b = pos_b < count_b ? b + pos_b * size : nullptr;
+                uint32_t id_a = rec_a ? ReadField(rec_a, fields[0]) : 0xffffffff;
+                uint32_t id_b = rec_b ? ReadField(rec_b, fields[0]) : 0xffffffff;
+                if (id_a == id_b)
+                {
+                    snprintf(object, sizeof object, "%s %08x", type, id_a);
+                    CompareRecords(object, rec_a, rec_b, fields, field_count);
+                    pos_a++;
+                    pos_b++;
+                }
+                else if (id_a < id_b)
+                {
+                    snprintf(object, sizeof object, "%s %08x only exists in the first dump", type, id_a);
+                    Report(object);
+                    pos_a++;
+                }
+                else
+                {
+                    snprintf(object, sizeof object, "%s %08x only exists in the second dump", type, id_b);
+                    Report(object);
+                    pos_b++;
+                }
+            }
+        }
+
+        /// Records which can only be compared by their position
+        void CompareIndexed(const char *type, const uint8_t *a, const uint8_t *b, uint32_t count_a,
+                uint32_t count_b, size_t size, const SyncDump::Field *fields, size_t field_count)
+        {
+            char object[64];
+            if (count_a != count_b)
+            {
+                if (difference_count != 0 && !list_all)
+                    return;
+                snprintf(object, sizeof object, "%s count: %u != %u", type, count_a, count_b);
+                Report(object);
+            }
+            uint32_t count = count_a < count_b ? count_a : count_b;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                snprintf(object, sizeof object, "%s #%u", type, i);
+                CompareRecords(object, a + i * size, b + i * size, fields, field_count);
+            }
+        }
+
+        bool list_all;
+        int difference_count;
+        uint32_t frame;
+};
+
+int main(int argc, char **argv)
+{
+    bool list_all = false;
+    vector<const char *> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-a") == 0)
+            list_all = true;
+        else
+            files.emplace_back(argv[i]);
+    }
+    if (files.size() != 2)
+    {
+        fprintf(stderr, "Usage: %s [-a] first.bin second.bin\n", argv[0]);
+        return 2;
+    }
+
+    DumpFile a(files[0]), b(files[1]);
+    if (!a.Open() || !b.Open())
+        return 2;
+
+    Differ differ(list_all);
+    Frame frame_a, frame_b;
+    bool has_a = a.Next(&frame_a), has_b = b.Next(&frame_b);
+    uint32_t frames = 0;
+    while (has_a && has_b)
+    {
+        // A dump may have been started later, or the game lagged in between
+        if (frame_a.header.frame < frame_b.header.frame)
+        {
+            has_a = a.Next(&frame_a);
+            continue;
+        }
+        if (frame_b.header.frame < frame_a.header.frame)
+        {
+            has_b = b.Next(&frame_b);
+            continue;
+        }
+        if (differ.CompareFrames(frame_a, frame_b))
+        {
+            if (list_all)
+                printf("%d differences\n", differ.DifferenceCount());
+            return 1;
+        }
+        frames++;
+        has_a = a.Next(&frame_a);
+        has_b = b.Next(&frame_b);
+    }
+    printf("%u frames match", frames);
+    if (has_a)
+        printf(", %s continues from frame %u", a.name, frame_a.header.frame);
+    else if (has_b)
+        printf(", %s continues from frame %u", b.name, frame_b.header.frame);
+    printf("\n");
+    return 0;
+}